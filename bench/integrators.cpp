@@ -0,0 +1,101 @@
+/**
+ * How long does each integrator take to reach a converged field?
+ *
+ * A tetrahedron of stars is rendered with each integrator at ever
+ * smaller delta_t, holding the simulated time (delta_t * iter_limit)
+ * fixed so the fields stay comparable. Each field is scored by the
+ * fraction of cells it classifies (escaped or not) the same as a
+ * reference rendered with RK4 at a very small delta_t. An integrator
+ * has converged once that fraction reaches the threshold.
+ *
+ * usage: mgsbench_integrators [cube_size] [threshold]
+ */
+
+#include <compute>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace mgs;
+
+static const floating_t simulated_time = 8.0;
+static const int reference_steps = 4096;
+
+static StarField make_field(indexer_t cube_size, IntegratorKind kind,
+                            int steps) {
+  Bounds box{Coordinate{-3, -3, -3}, Coordinate{3, 3, 3}};
+  StarField field(box, cube_size, 3, steps, 1.0, 6.0,
+                  simulated_time / steps);
+  field.parms.integrator = kind;
+  const floating_t c = 1.0;
+  field.stars.push_back(Star{1.0, {-c, -c, -c}});
+  field.stars.push_back(Star{1.0, {c, -c, c}});
+  field.stars.push_back(Star{1.0, {-c, c, c}});
+  field.stars.push_back(Star{1.0, {c, c, -c}});
+  return field;
+}
+
+static vector<bool> classify(const StarField& field) {
+  vector<bool> bound(field.grid.size());
+  for (size_t i = 0; i < field.grid.size(); ++i)
+    bound[i] = field.grid[i] >= field.parms.iter_limit;
+  return bound;
+}
+
+static double agreement(const vector<bool>& a, const vector<bool>& b) {
+  size_t same = 0;
+  for (size_t i = 0; i < a.size(); ++i) same += a[i] == b[i];
+  return double(same) / double(a.size());
+}
+
+static double timed_render(StarField& field) {
+  auto start = chrono::steady_clock::now();
+  field.render_with_callback(nullptr);
+  return chrono::duration<double>(chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char* argv[]) {
+  indexer_t cube_size = argc > 1 ? atoi(argv[1]) : 16;
+  double threshold = argc > 2 ? atof(argv[2]) : 0.99;
+
+  auto reference = make_field(cube_size, IntegratorKind::rk4, reference_steps);
+  cout << "reference: rk4, " << reference_steps << " steps, "
+       << timed_render(reference) << "s\n\n";
+  auto truth = classify(reference);
+
+  cout << setw(10) << "integrator" << setw(8) << "steps" << setw(12)
+       << "delta_t" << setw(12) << "evals" << setw(10) << "seconds"
+       << setw(11) << "agreement\n";
+
+  for (auto kind : {IntegratorKind::euler, IntegratorKind::leapfrog,
+                    IntegratorKind::yoshida4, IntegratorKind::rk4}) {
+    double total_seconds = 0;
+    bool converged = false;
+    for (int steps = 32; steps <= reference_steps / 2 && !converged;
+         steps *= 2) {
+      auto field = make_field(cube_size, kind, steps);
+      auto seconds = timed_render(field);
+      auto score = agreement(classify(field), truth);
+      auto evals = with_integrator(kind, [](auto integrator) {
+        return decltype(integrator)::evaluations;
+      });
+      total_seconds += seconds;
+      converged = score >= threshold;
+
+      cout << setw(10) << integrator_name(kind) << setw(8) << steps
+           << setw(12) << field.parms.delta_t << setw(12) << evals * steps
+           << setw(10) << fixed << setprecision(3) << seconds << setw(10)
+           << setprecision(4) << score << (converged ? " *" : "") << '\n'
+           << defaultfloat;
+    }
+    cout << setw(10) << integrator_name(kind) << ": "
+         << (converged ? "converged" : "did not converge") << " after "
+         << total_seconds << "s of rendering\n\n";
+  }
+  return 0;
+}
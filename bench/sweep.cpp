@@ -0,0 +1,75 @@
+/**
+ * How much does a parameter sweep save over a render per parameter
+ * set?
+ *
+ * A square of stars is rendered at points gravitational constants
+ * either side of 1, once by render_sweep() and once a render at a
+ * time, on a single thread, and the two timed against each other.
+ * The fields have to come out the same.
+ *
+ * usage: mgsbench_sweep [cube_size] [points]
+ */
+
+#include <sweep>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace mgs;
+
+static StarField make_field(indexer_t cube_size) {
+  Bounds box{Coordinate{-2, -2, 0}, Coordinate{2, 2, 0}};
+  StarField field(box, cube_size, 2, 256, 1.0, 6.0, 0.05);
+  field.stars.push_back(Star{1.0, {-1, 0, 0}});
+  field.stars.push_back(Star{1.0, {1, 0, 0}});
+  field.stars.push_back(Star{1.0, {0, 1, 0}});
+  field.stars.push_back(Star{1.0, {0, -1, 0}});
+  return field;
+}
+
+template <typename F>
+static double timed(F&& f) {
+  auto start = chrono::steady_clock::now();
+  f();
+  return chrono::duration<double>(chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char* argv[]) {
+  indexer_t cube_size = argc > 1 ? atoi(argv[1]) : 160;
+  int n_points = argc > 2 ? atoi(argv[2]) : 16;
+
+  auto field = make_field(cube_size);
+  vector<SweepPoint> points;
+  for (int i = 0; i < n_points; ++i)
+    points.push_back({0.9 + 0.2 * i / max(1, n_points - 1), 0.05, {}});
+  RenderOptions options;
+  options.threads = 1;
+
+  vector<StarField> swept;
+  auto sweep_seconds =
+      timed([&] { render_sweep(field, points, swept, options); });
+
+  bool same = true;
+  auto separate_seconds = timed([&] {
+    for (size_t i = 0; i < points.size(); ++i) {
+      auto one = field;
+      one.parms.gravitational_constant = points[i].gravitational_constant;
+      RenderOptions own;
+      own.threads = 1;
+      one.render_with_callback(nullptr, own);
+      same &= one.grid == swept[i].grid;
+    }
+  });
+
+  cout << points.size() << " points, " << cube_size << "^2 cells, "
+       << sweep_lanes << " lanes\n"
+       << "  sweep:    " << sweep_seconds << "s\n"
+       << "  separate: " << separate_seconds << "s\n"
+       << "  speedup:  " << separate_seconds / sweep_seconds << "x"
+       << (same ? "" : "  (fields differ!)") << '\n';
+  return same ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+/**
+ * Precomputed acceleration table, an approximate fast mode.
+ *
+ * The stars stand still for the duration of a field render, so the
+ * acceleration is a fixed function of position. AccelGrid samples it
+ * once, at render start, on a regular lattice of nodes over the
+ * render bounds, after which each evaluation costs a table lookup and
+ * an interpolation whatever the number of stars:
+ *
+ *  + trilinear: the 8 surrounding nodes, continuous but with kinks
+ *    across the cell faces;
+ *  + tricubic: Catmull-Rom over the 4x4x4 surrounding nodes, C1
+ *    (trilinear in the outermost cells, where that runs off the
+ *    table).
+ *
+ * Near a star the field is too steep for any table, so cells within
+ * the guard radius of a star (allowing for the interpolation stencil)
+ * are flagged at build time, and there, as well as outside the
+ * bounds, the exact kernel is evaluated instead.
+ *
+ * Once built, the table's error against the exact kernel is measured
+ * at the cell centers, where interpolation is worst, and kept as its
+ * AccelGridError.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "render_job.h"
+#include "types.h"
+#include "vec3.h"
+
+namespace mgs {
+  const int default_accel_grid_size = 64;
+
+  struct AccelGridError {
+    double max_relative = 0;
+    double rms_relative = 0;
+    std::uint64_t samples = 0;
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, const AccelGridError& e) {
+    os << "AccelGridError[ max_relative:" << e.max_relative
+       << " rms_relative:" << e.rms_relative << " samples:" << e.samples
+       << " ]";
+    return os;
+  }
+
+  template <typename T>
+  class AccelGrid {
+   public:
+    /**
+     * Samples the exact kernel at size^3 nodes spanning lo to hi,
+     * a plane of nodes at a time on the given number of threads, the
+     * pool's if given. Cancelling the token leaves the table
+     * incomplete; check complete() before using it.
+     */
+    template <typename Kernel>
+    AccelGrid(const Kernel& exact, const std::vector<Star>& stars,
+              const Vec3<T>& lo, const Vec3<T>& hi, int size,
+              AccelInterpolation interpolation, T guard_radius,
+              unsigned threads = 1, const CancelToken& token = {},
+              ThreadPool* pool = nullptr)
+        : m_lo(lo),
+          m_size(std::max(size, 4)),
+          m_interpolation(interpolation) {
+      for (indexer_t d = 0; d < 3; ++d) {
+        m_spacing[d] = (hi[d] - lo[d]) / (m_size - 1);
+        if (m_spacing[d] <= 0) m_spacing[d] = 1;
+      }
+      const std::size_t n = m_size;
+      m_nodes.resize(n * n * n);
+      auto sample_plane = [&](std::size_t k) {
+        for (std::size_t j = 0; j < n; ++j)
+          for (std::size_t i = 0; i < n; ++i)
+            m_nodes[node(i, j, k)] = exact(node_position(i, j, k));
+      };
+      for_each_brick_parallel(n, threads, token, sample_plane, nullptr, pool);
+      m_complete = !token.cancelled();
+      flag_guarded(stars, guard_radius);
+      if (m_complete) measure(exact, threads, token, pool);
+    }
+
+    bool complete() const { return m_complete; }
+    const AccelGridError& error() const { return m_error; }
+    int size() const { return m_size; }
+
+    /**
+     * Interpolates the acceleration at p into a, returning false
+     * (and leaving a alone) if p is out of bounds or guarded.
+     */
+    inline bool lookup(const Vec3<T>& p, Vec3<T>& a) const {
+      T f[3];
+      std::size_t c[3];
+      for (indexer_t d = 0; d < 3; ++d) {
+        T u = (p[d] - m_lo[d]) / m_spacing[d];
+        if (!(u >= 0 && u < m_size - 1)) return false;
+        c[d] = static_cast<std::size_t>(u);
+        f[d] = u - c[d];
+      }
+      if (m_guarded[cell(c[0], c[1], c[2])]) return false;
+      a = interpolate(c, f);
+      return true;
+    }
+
+   private:
+    Vec3<T> m_lo;
+    T m_spacing[3];
+    int m_size;
+    AccelInterpolation m_interpolation;
+    std::vector<Vec3<T>> m_nodes;
+    std::vector<bool> m_guarded;  // per cell, (size - 1)^3
+    bool m_complete = false;
+    AccelGridError m_error;
+
+    inline std::size_t node(std::size_t i, std::size_t j,
+                            std::size_t k) const {
+      return i + m_size * (j + m_size * k);
+    }
+    inline std::size_t cell(std::size_t i, std::size_t j,
+                            std::size_t k) const {
+      const std::size_t n = m_size - 1;
+      return i + n * (j + n * k);
+    }
+    inline Vec3<T> node_position(std::size_t i, std::size_t j,
+                                 std::size_t k) const {
+      return Vec3<T>{m_lo.x + m_spacing[0] * i, m_lo.y + m_spacing[1] * j,
+                     m_lo.z + m_spacing[2] * k};
+    }
+
+    /**
+     * A cell is guarded if its interpolation stencil has a node
+     * within the guard radius of a star: the stencil reaches one
+     * node further out for tricubic.
+     */
+    void flag_guarded(const std::vector<Star>& stars, const T guard_radius) {
+      const int n = m_size - 1;
+      const int reach = m_interpolation == AccelInterpolation::tricubic ? 1 : 0;
+      m_guarded.assign(std::size_t(n) * n * n, false);
+      for (const auto& star : stars) {
+        Vec3<T> s(star.position);
+        int from[3], to[3];
+        for (indexer_t d = 0; d < 3; ++d) {
+          // the cells either side of every node within the radius
+          from[d] = int(std::floor((s[d] - guard_radius - m_lo[d]) /
+                                   m_spacing[d])) - 1 - reach;
+          to[d] = int(std::floor((s[d] + guard_radius - m_lo[d]) /
+                                 m_spacing[d])) + reach;
+          from[d] = std::max(from[d], 0);
+          to[d] = std::min(to[d], n - 1);
+        }
+        for (int k = from[2]; k <= to[2]; ++k)
+          for (int j = from[1]; j <= to[1]; ++j)
+            for (int i = from[0]; i <= to[0]; ++i)
+              m_guarded[cell(i, j, k)] = true;
+      }
+    }
+
+    /**
+     * The tricubic stencil would run off the table in the outermost
+     * cells, so those are trilinear either way.
+     */
+    inline Vec3<T> interpolate(const std::size_t c[3], const T f[3]) const {
+      if (m_interpolation == AccelInterpolation::tricubic) {
+        const std::size_t last = m_size - 2;
+        if (c[0] > 0 && c[1] > 0 && c[2] > 0 && c[0] < last && c[1] < last &&
+            c[2] < last)
+          return tricubic(c, f);
+      }
+      return trilinear(c, f);
+    }
+
+    inline Vec3<T> trilinear(const std::size_t c[3], const T f[3]) const {
+      auto lerp = [](const Vec3<T>& a, const Vec3<T>& b, T t) {
+        return a + (b - a) * t;
+      };
+      const auto i = c[0], j = c[1], k = c[2];
+      auto x00 = lerp(m_nodes[node(i, j, k)], m_nodes[node(i + 1, j, k)], f[0]);
+      auto x10 = lerp(m_nodes[node(i, j + 1, k)],
+                      m_nodes[node(i + 1, j + 1, k)], f[0]);
+      auto x01 = lerp(m_nodes[node(i, j, k + 1)],
+                      m_nodes[node(i + 1, j, k + 1)], f[0]);
+      auto x11 = lerp(m_nodes[node(i, j + 1, k + 1)],
+                      m_nodes[node(i + 1, j + 1, k + 1)], f[0]);
+      return lerp(lerp(x00, x10, f[1]), lerp(x01, x11, f[1]), f[2]);
+    }
+
+    // Catmull-Rom weights for nodes -1, 0, 1, 2 at fraction t
+    static inline void cubic_weights(const T t, T w[4]) {
+      const T t2 = t * t, t3 = t2 * t;
+      w[0] = (-t3 + 2 * t2 - t) / 2;
+      w[1] = (3 * t3 - 5 * t2 + 2) / 2;
+      w[2] = (-3 * t3 + 4 * t2 + t) / 2;
+      w[3] = (t3 - t2) / 2;
+    }
+
+    inline Vec3<T> tricubic(const std::size_t c[3], const T f[3]) const {
+      T w[3][4];
+      for (indexer_t d = 0; d < 3; ++d) cubic_weights(f[d], w[d]);
+      Vec3<T> a;
+      for (int sk = 0; sk < 4; ++sk)
+        for (int sj = 0; sj < 4; ++sj) {
+          Vec3<T> row;
+          for (int si = 0; si < 4; ++si)
+            row += m_nodes[node(c[0] + si - 1, c[1] + sj - 1,
+                                c[2] + sk - 1)] *
+                   w[0][si];
+          a += row * (w[1][sj] * w[2][sk]);
+        }
+      return a;
+    }
+
+    template <typename Kernel>
+    void measure(const Kernel& exact, unsigned threads,
+                 const CancelToken& token, ThreadPool* pool) {
+      const std::size_t n = m_size - 1;
+      std::mutex merge;
+      double sum_squares = 0;
+      auto measure_slab = [&](std::size_t k) {
+        AccelGridError slab;
+        double slab_squares = 0;
+        const T half[3] = {T(0.5), T(0.5), T(0.5)};
+        for (std::size_t j = 0; j < n; ++j)
+          for (std::size_t i = 0; i < n; ++i) {
+            if (m_guarded[cell(i, j, k)]) continue;
+            auto p = node_position(i, j, k) +
+                     Vec3<T>{m_spacing[0], m_spacing[1], m_spacing[2]} / T(2);
+            auto expected = exact(p);
+            const std::size_t c[3] = {i, j, k};
+            auto approx = interpolate(c, half);
+            double scale = expected.norm();
+            if (scale <= 0) continue;
+            double rel = (approx - expected).norm() / scale;
+            slab.max_relative = std::max(slab.max_relative, rel);
+            slab_squares += rel * rel;
+            ++slab.samples;
+          }
+        std::lock_guard<std::mutex> lock(merge);
+        m_error.max_relative = std::max(m_error.max_relative, slab.max_relative);
+        m_error.samples += slab.samples;
+        sum_squares += slab_squares;
+      };
+      for_each_brick_parallel(n, threads, token, measure_slab, nullptr, pool);
+      if (m_error.samples)
+        m_error.rms_relative = std::sqrt(sum_squares / m_error.samples);
+    }
+  };
+
+  /**
+   * The acceleration kernel reading an AccelGrid, falling back on the
+   * exact kernel it was built from wherever the table does not apply.
+   * The table must outlive it.
+   */
+  template <typename T, typename Exact>
+  struct AccelGridKernel {
+    using vector_type = Vec3<T>;
+
+    const AccelGrid<T>& table;
+    const Exact& exact;
+    decltype(Exact::far) far;
+    bool has_capture;
+
+    AccelGridKernel(const AccelGrid<T>& g, const Exact& e)
+        : table(g), exact(e), far(e.far), has_capture(e.has_capture) {}
+
+    inline Vec3<T> operator()(const Vec3<T>& p) const {
+      Vec3<T> a;
+      if (table.lookup(p, a)) return a;
+      return exact(p);
+    }
+
+    inline star_index_t capture(const Vec3<T>& p) const {
+      return exact.capture(p);
+    }
+  };
+}  // namespace mgs
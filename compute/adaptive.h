@@ -0,0 +1,158 @@
+#pragma once
+
+/**
+ * Adaptive time stepping for a single Free Point Mass.
+ *
+ * With a fixed delta_t, the step has to be small enough for the
+ * closest pass by a star, which is wasted on the long stretches an
+ * FPM spends far from the cluster. Here each FPM picks its own step
+ * from its local acceleration and jerk,
+ *
+ *   dt = eta * |a| / |j|
+ *
+ * i.e. a fraction eta of the time over which the acceleration would
+ * change by itself. The jerk is estimated from successive evaluations
+ * of the acceleration kernel, so it costs no extra evaluations. The
+ * step is clamped to [delta_t / adaptive_min_divisor,
+ * delta_t * adaptive_max_factor], and may at most double per step.
+ *
+ * Everything is expressed in simulated time, so that the results
+ * stay comparable with the fixed step render: the iteration limit
+ * becomes a limit of iter_limit * delta_t of simulated time, and the
+ * iteration count returned is the simulated time elapsed in units
+ * of delta_t. The analytic far-field fast forward of kepler.h
+ * applies here as well.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "compute.h"
+
+namespace mgs {
+  const floating_t adaptive_max_factor = 16.0;
+  const floating_t adaptive_min_divisor = 256.0;
+
+  /**
+   * As integrate_cell(), but stepping adaptively. The observer is
+   * called after every actual step taken. Capture and the outcome
+   * are as there, the escape time in units of the nominal step.
+   */
+  template <typename T, typename I, typename Integrator = Euler,
+            typename Kernel, typename V, typename Observer = NullObserver>
+  inline I integrate_cell_adaptive(V p, V v, const Kernel& kernel,
+                                   const V& center,
+                                   const FieldParms<T, I>& parms,
+                                   Observer&& observe = Observer{},
+                                   CellOutcome<T>* outcome = nullptr) {
+    const T nominal_dt = parms.delta_t;
+    const T time_limit = nominal_dt * parms.iter_limit;
+    const T escape_radius = parms.escape_radius;
+    const T dt_max = nominal_dt * adaptive_max_factor;
+    const T dt_min = nominal_dt / adaptive_min_divisor;
+
+    // the most recent evaluation, and the time it was made at
+    V last_a{};
+    T last_a_time = 0;
+    bool have_a = false;
+    T jerk_estimate = 0;
+    T t = 0;
+    T step_start = 0;
+    T dt = nominal_dt;
+    T last_r = 0;  // before the latest step
+    CellOutcome<T> ignored;
+    CellOutcome<T>& out = outcome ? *outcome : ignored;
+    out = CellOutcome<T>{};
+    out.escape_time = parms.iter_limit;
+
+    auto accel = [&](const V& at) {
+      auto a = kernel(at);
+      // the evaluation point lies somewhere within the current step
+      T now = step_start + dt / 2;
+      if (have_a && now > last_a_time) {
+        jerk_estimate = (a - last_a).norm() / (now - last_a_time);
+      }
+      last_a = a;
+      last_a_time = now;
+      have_a = true;
+      return a;
+    };
+
+    while (t < time_limit) {
+      T r = (p - center).norm();
+      if (r > escape_radius) {
+        T crossing = t;
+        if (t > step_start && r > last_r)
+          crossing = step_start + (t - step_start) *
+                                      (escape_radius - last_r) / (r - last_r);
+        out.escape_time = crossing / nominal_dt;
+        break;
+      }
+
+      if (kernel.has_capture) {
+        auto star = kernel.capture(p);
+        if (star != not_captured) {
+          out.captured_by = star;
+          return parms.iter_limit;
+        }
+      }
+
+      if (r > kernel.far.switch_radius) {
+        auto leg = kepler_outbound_leg<T>(p, v, center, kernel.far.mu,
+                                          escape_radius);
+        if (leg.applicable) {
+          t = std::min(time_limit, t + leg.time);
+          if (leg.escapes) {
+            out.escape_time = t / nominal_dt;
+            break;
+          }
+          step_start = t;
+          p = leg.p;
+          v = leg.v;
+          have_a = false;
+          observe(p, v);
+          continue;
+        }
+      }
+
+      step_start = t;
+      last_r = r;
+      dt = std::min(dt, time_limit - t);
+      Integrator::step(p, v, dt, accel);
+      t += dt;
+      observe(p, v);
+
+      T next = dt_max;
+      if (jerk_estimate > 0) {
+        next = parms.adaptive_eta * last_a.norm() / jerk_estimate;
+      }
+      dt = std::clamp(std::min(next, dt * 2), dt_min, dt_max);
+    }
+
+    auto iter = static_cast<T>(std::floor(t / nominal_dt + 1e-9));
+    return static_cast<I>(std::min<T>(iter, parms.iter_limit));
+  }
+
+  /**
+   * As render_single_cell(), but stepping adaptively.
+   */
+  template <typename T, typename I, typename Integrator = Euler,
+            typename Observer = NullObserver>
+  inline I render_single_cell_adaptive(const Position& initial_p,
+                                       const Velocity& initial_v,
+                                       const std::vector<Star>& stars,
+                                       const Position& center_of_star_mass,
+                                       const FieldParms<T, I>& parms,
+                                       Observer&& observe = Observer{}) {
+    return with_force_law(
+        parms.force_law, parms.softening, parms.force_exponent,
+        [&](const auto& law) {
+          DirectSumKernel<T, I, std::decay_t<decltype(law)>> kernel(
+              stars, center_of_star_mass, parms.gravitational_constant,
+              parms.kepler_tolerance, law, parms.capture_radius);
+          return integrate_cell_adaptive<T, I, Integrator>(
+              initial_p, initial_v, kernel, center_of_star_mass, parms,
+              std::forward<Observer>(observe));
+        });
+  }
+}  // namespace mgs
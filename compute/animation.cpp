@@ -0,0 +1,244 @@
+#include <animation.h>
+
+#include <wire.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace mgs {
+  using namespace wire;
+  namespace fs = std::filesystem;
+
+  namespace {
+    const std::uint32_t frame_file_magic = 0x4153474d;  // "MGSA"
+
+    floating_t between(floating_t a, floating_t b, floating_t t) {
+      return a + (b - a) * t;
+    }
+
+    // whether the frame's file is there, for a render of the signature
+    bool frame_done(const std::string& path, std::uint64_t signature) {
+      std::ifstream in(path, std::ios::binary);
+      std::uint8_t bytes[sizeof(std::uint32_t) + sizeof(std::uint64_t)];
+      if (!in.read(reinterpret_cast<char*>(bytes), sizeof bytes))
+        return false;
+      Reader r(bytes, sizeof bytes);
+      std::uint32_t magic = 0;
+      std::uint64_t had = 0;
+      r.io(magic);
+      r.io(had);
+      return r.good() && magic == frame_file_magic && had == signature;
+    }
+
+    // written aside and renamed, so there is all of it or none
+    bool write_frame(const std::string& path, std::uint64_t signature,
+                     const StarField& field) {
+      Writer file;
+      file.io(frame_file_magic);
+      file.io(signature);
+      write_results(file, field);
+      const std::string aside = path + ".tmp";
+      {
+        std::ofstream out(aside, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(file.bytes().data()),
+                  file.bytes().size());
+        if (!out) {
+          std::error_code ec;
+          fs::remove(aside, ec);
+          return false;
+        }
+      }
+      std::error_code ec;
+      fs::rename(aside, path, ec);
+      if (ec) fs::remove(aside, ec);
+      return !ec;
+    }
+
+    // the export thread's side of the pipeline
+    struct Exports {
+      std::mutex lock;
+      std::condition_variable changed;
+      std::deque<std::size_t> ready;  // slots rendered, in frame order
+      std::array<bool, 2> exporting{};
+      std::array<std::size_t, 2> frame_of{};
+      std::array<std::uint64_t, 2> signature_of{};
+      bool done = false;
+    };
+  }  // namespace
+
+  AnimationKeyframe keyframe_of(const StarField& field, std::size_t frame) {
+    return {frame, field.stars, field.parms.gravitational_constant,
+            field.parms.delta_t};
+  }
+
+  AnimationKeyframe interpolate_keyframes(
+      const std::vector<AnimationKeyframe>& keyframes, std::size_t frame) {
+    if (keyframes.empty()) return {frame, {}, 0, 0};
+    std::vector<const AnimationKeyframe*> keys;
+    for (const auto& key : keyframes) keys.push_back(&key);
+    std::stable_sort(keys.begin(), keys.end(), [](auto* a, auto* b) {
+      return a->frame < b->frame;
+    });
+
+    auto after = std::upper_bound(
+        keys.begin(), keys.end(), frame,
+        [](std::size_t f, const AnimationKeyframe* k) { return f < k->frame; });
+    // held before the first and after the last
+    const auto& a = after == keys.begin() ? *keys.front() : **std::prev(after);
+    if (after == keys.begin() || after == keys.end() || a.frame == frame ||
+        a.stars.size() != (*after)->stars.size())
+      return {frame, a.stars, a.gravitational_constant, a.delta_t};
+
+    const auto& b = **after;
+    const floating_t t =
+        floating_t(frame - a.frame) / floating_t(b.frame - a.frame);
+    AnimationKeyframe key{frame, {}, between(a.gravitational_constant,
+                                             b.gravitational_constant, t),
+                          between(a.delta_t, b.delta_t, t)};
+    for (std::size_t s = 0; s < a.stars.size(); ++s) {
+      const auto& sa = a.stars[s];
+      const auto& sb = b.stars[s];
+      key.stars.emplace_back(
+          between(sa.mass, sb.mass, t),
+          sa.position + (sb.position - sa.position) * t,
+          between(sa.capture_radius, sb.capture_radius, t));
+    }
+    return key;
+  }
+
+  AnimationReport render_animation(
+      const StarField& field, const std::vector<AnimationKeyframe>& keyframes,
+      std::size_t frames, const AnimationOptions& options,
+      const frame_callback_t& on_frame) {
+    using clock = std::chrono::steady_clock;
+    const auto started = clock::now();
+    AnimationReport report;
+    const auto& token = options.render.token;
+
+    RenderOptions render = options.render;
+    if (!render.pool)
+      render.pool = std::make_shared<ThreadPool>(render.threads);
+    render.threads = render.pool->size();
+    const bool keeping = !options.directory.empty();
+    if (keeping) {
+      std::error_code ec;
+      fs::create_directories(options.directory, ec);
+    }
+
+    // made as first needed, then rendered into frame after frame
+    std::array<StarField, 2> slots;
+    std::array<bool, 2> made{};
+    Exports exports;
+
+    std::thread exporter([&] {
+      std::unique_lock<std::mutex> lock(exports.lock);
+      for (;;) {
+        exports.changed.wait(
+            lock, [&] { return exports.done || !exports.ready.empty(); });
+        if (exports.ready.empty()) return;
+        const std::size_t s = exports.ready.front();
+        const std::size_t frame = exports.frame_of[s];
+        const std::uint64_t signature = exports.signature_of[s];
+        lock.unlock();
+        if (on_frame) on_frame(frame, slots[s]);
+        const bool written =
+            keeping && write_frame(animation_frame_path(options.directory,
+                                                        frame),
+                                   signature, slots[s]);
+        lock.lock();
+        if (written) ++report.exported;
+        exports.ready.pop_front();
+        exports.exporting[s] = false;
+        exports.changed.notify_all();
+      }
+    });
+
+    std::size_t s = 0;
+    for (std::size_t frame = 0; frame < frames && !token.cancelled();
+         ++frame) {
+      {
+        std::unique_lock<std::mutex> lock(exports.lock);
+        exports.changed.wait(lock, [&] { return !exports.exporting[s]; });
+      }
+      auto& slot = slots[s];
+      if (!made[s]) {
+        slot = field;
+        slot.resume.keep(false);  // no frame goes on from another's orbits
+        made[s] = true;
+        ++report.grids_allocated;
+      }
+      auto key = interpolate_keyframes(keyframes, frame);
+      slot.stars = std::move(key.stars);
+      slot.parms.gravitational_constant = key.gravitational_constant;
+      slot.parms.delta_t = key.delta_t;
+      const std::uint64_t signature = slot.signature();
+      if (keeping && options.resume &&
+          frame_done(animation_frame_path(options.directory, frame),
+                     signature)) {
+        ++report.resumed;
+        continue;
+      }
+
+      // in place, on this thread; the pool does the passes
+      slot.render_with_callback(nullptr, render);
+      if (token.cancelled()) break;
+      ++report.rendered;
+
+      {
+        std::lock_guard<std::mutex> guard(exports.lock);
+        exports.exporting[s] = true;
+        exports.frame_of[s] = frame;
+        exports.signature_of[s] = signature;
+        exports.ready.push_back(s);
+      }
+      exports.changed.notify_all();
+      s ^= 1;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(exports.lock);
+      exports.done = true;
+    }
+    exports.changed.notify_all();
+    exporter.join();
+
+    report.status = token.cancelled() ? RenderStatus::cancelled
+                                      : RenderStatus::completed;
+    const std::chrono::duration<double> seconds = clock::now() - started;
+    report.seconds = seconds.count();
+    return report;
+  }
+
+  std::string animation_frame_path(const std::string& directory,
+                                   std::size_t frame) {
+    std::ostringstream name;
+    name << "frame_" << std::setw(6) << std::setfill('0') << frame << ".mgsa";
+    return (fs::path(directory) / name.str()).string();
+  }
+
+  bool read_animation_frame(const std::string& directory, std::size_t frame,
+                            StarField& field, std::uint64_t* signature) {
+    std::ifstream in(animation_frame_path(directory, frame), std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+    Reader r(bytes.data(), bytes.size());
+    std::uint32_t magic = 0;
+    std::uint64_t had = 0;
+    r.io(magic);
+    r.io(had);
+    if (!r.good() || magic != frame_file_magic || !read_results(r, field))
+      return false;
+    if (signature) *signature = had;
+    return true;
+  }
+}  // namespace mgs
@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * Batch rendering of animations: sequences of frames, hundreds of
+ * them for a planetarium show, in which the stars move and change
+ * mass, and the constant and step change, between keyframes.
+ *
+ * render_animation() renders all the frames of a sequence on one
+ * ThreadPool, kept for the whole of it, into two fields it keeps
+ * from frame to frame, so the grids are allocated once and not once
+ * a frame. While one frame computes, the last one is handed to the
+ * caller's on_frame (say, to mesh it) and written out, on a thread
+ * of its own, so the export of frame N goes on alongside the compute
+ * of frame N + 1; the compute of N + 2 waits for it, if need be.
+ *
+ * Each frame goes to a file of its own in the animation's directory,
+ * written aside and renamed into place once on_frame is done with
+ * it, with the signature (Field::signature()) of the frame's render.
+ * A sequence stopped part way, cancelled or killed, is resumed by
+ * rendering it again: frames already there, of the same signature,
+ * are skipped, and only those missing, or whose keyframes changed,
+ * are rendered.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  // the stars and parameters at a frame; those between, interpolated
+  struct AnimationKeyframe {
+    std::size_t frame;
+    std::vector<Star> stars;
+    floating_t gravitational_constant;
+    floating_t delta_t;
+  };
+
+  // the field's stars and parameters, as a keyframe at the given frame
+  AnimationKeyframe keyframe_of(const StarField& field, std::size_t frame);
+
+  /**
+   * The keyframe at the frame: the two keyframes either side of it
+   * interpolated linearly, star by star (position, mass and capture
+   * radius), or the first or last if it is before or after them all.
+   * Stars pair up in order; keyframes with different numbers of them
+   * hold the earlier one's until the later one's frame.
+   */
+  AnimationKeyframe interpolate_keyframes(
+      const std::vector<AnimationKeyframe>& keyframes, std::size_t frame);
+
+  struct AnimationOptions {
+    // for each frame; the pool is made for the animation if not given,
+    // and cancelling the token stops it after the frames done so far
+    RenderOptions render;
+    // where the frames go, made if need be; empty to keep none
+    std::string directory;
+    bool resume = true;  // skip frames already in the directory
+  };
+
+  struct AnimationReport {
+    RenderStatus status = RenderStatus::completed;
+    std::size_t rendered = 0;  // this time
+    std::size_t resumed = 0;   // found already done
+    std::size_t exported = 0;  // written to the directory
+    std::size_t grids_allocated = 0;
+    double seconds = 0;
+  };
+
+  inline std::ostream& operator<<(std::ostream& os,
+                                  const AnimationReport& r) {
+    os << "AnimationReport[ "
+       << (r.status == RenderStatus::completed ? "completed" : "cancelled")
+       << " rendered:" << r.rendered << " resumed:" << r.resumed
+       << " exported:" << r.exported
+       << " grids_allocated:" << r.grids_allocated << " seconds:" << r.seconds
+       << " ]";
+    return os;
+  }
+
+  /**
+   * Called once a frame is rendered, on the export thread, while the
+   * next computes; the field is only valid for the duration of the
+   * call. Frames resumed are not rendered, and not handed to it.
+   */
+  using frame_callback_t =
+      std::function<void(std::size_t frame, const StarField& field)>;
+
+  /**
+   * Renders frames 0 to frames - 1 of the field (its bounds,
+   * resolution, channels and other parameters) under the keyframes,
+   * blocking until done or cancelled.
+   */
+  AnimationReport render_animation(
+      const StarField& field, const std::vector<AnimationKeyframe>& keyframes,
+      std::size_t frames, const AnimationOptions& options = {},
+      const frame_callback_t& on_frame = nullptr);
+
+  // the file the frame goes to in the directory
+  std::string animation_frame_path(const std::string& directory,
+                                   std::size_t frame);
+
+  /**
+   * Reads the frame back from the directory into the field's grid
+   * and channels, as for read_result_file(); its signature is
+   * returned through signature, if given.
+   */
+  bool read_animation_frame(const std::string& directory, std::size_t frame,
+                            StarField& field,
+                            std::uint64_t* signature = nullptr);
+}  // namespace mgs
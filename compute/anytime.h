@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * Anytime rendering: the best field to be had within a time budget.
+ *
+ * Field::render_anytime() renders the levels of a progressive render
+ * (progressive.h), coarse to fine, until its deadline, at which point
+ * it stops within the time of a cell. Within each finer level the
+ * bricks go in order of how much they stand to gain:
+ *
+ *  1. the coarsest level, in full;
+ *  2. bricks straddling a boundary, i.e. whose cells done so far
+ *     disagree, the more so the sooner;
+ *  3. bricks within the region of interest, if any;
+ *
+ * and the bricks of neither kind, flat and out of view, are left to
+ * a second sweep over the levels once the others are all done.
+ *
+ * Only cells still untouched are rendered, so a later call with a
+ * larger budget carries on from where the last one stopped, as long
+ * as nothing the render depends on (Field::signature()) has changed
+ * in between; if it has, the grid starts over. Whatever stage it
+ * stopped at, every cell is either done or untouched, and
+ * Field::at_best() reads the field at the finest resolution done
+ * about each cell.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+
+#include "progressive.h"
+#include "render_job.h"
+#include "types.h"
+
+namespace mgs {
+  // how often an anytime render checks on its caller's token
+  const std::chrono::milliseconds anytime_poll{5};
+
+  struct AnytimeOptions {
+    using clock = std::chrono::steady_clock;
+
+    // the render stops at whichever of these is sooner
+    std::chrono::milliseconds budget{200};
+    std::optional<clock::time_point> deadline;
+
+    // e.g. about the camera's focus, or a thin box along a slice
+    // plane: bricks overlapping it go before the other flat ones
+    std::optional<Bounds> region_of_interest;
+
+    std::int32_t coarsest_stride = default_coarsest_stride;
+
+    clock::time_point until(clock::time_point now) const {
+      auto end = now + budget;
+      return deadline && *deadline < end ? *deadline : end;
+    }
+  };
+
+  struct AnytimeResult {
+    // ran out of time (or was cancelled) before every cell was done
+    RenderStatus status = RenderStatus::completed;
+    // the finest stride done all over, 0 if not even the coarsest
+    std::int32_t complete_stride = 0;
+    std::uint64_t cells_done = 0;  // in all, this call or before
+    std::uint64_t cells_total = 0;
+    double seconds = 0;
+
+    bool complete() const { return complete_stride == 1; }
+    double fraction() const {
+      return cells_total ? double(cells_done) / double(cells_total) : 1.0;
+    }
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, const AnytimeResult& r) {
+    os << "AnytimeResult[ "
+       << (r.status == RenderStatus::completed ? "completed" : "stopped")
+       << " complete_stride:" << r.complete_stride
+       << " cells_done:" << r.cells_done << "/" << r.cells_total
+       << " seconds:" << r.seconds << " ]";
+    return os;
+  }
+}  // namespace mgs
@@ -0,0 +1,167 @@
+#pragma once
+
+/**
+ * Bricks are the unit of work for rendering a Field. The
+ * field's cube is cut into axis aligned blocks of cells,
+ * which are handed out to the worker threads one at a time.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mgs {
+  using brick_id_t = std::size_t;
+
+  // 16^3 cells, small enough to keep the tail of a render short,
+  // large enough to keep the scheduling overhead negligible.
+  const std::int32_t default_brick_size = 16;
+
+  /**
+   * A single brick. origin is the index of its negative-most
+   * cell, extent the number of cells along each axis (bricks
+   * on the positive faces of the cube may be clipped).
+   */
+  struct Brick {
+    brick_id_t id = 0;
+    std::vector<std::int32_t> origin;
+    std::vector<std::int32_t> extent;
+
+    std::size_t cells() const {
+      std::size_t n = 1;
+      for (auto e : extent) n *= static_cast<std::size_t>(e);
+      return n;
+    }
+  };
+
+  /**
+   * Visit the cells of the brick whose indices are all multiples
+   * of stride, skipping those whose indices are all multiples of
+   * skip (0 skips nothing). The first axis varies fastest (the
+   * same order as the field's grid), and the visitor is handed the
+   * absolute index of the cell.
+   */
+  template <typename F>
+  inline void for_each_cell_strided(const Brick& brick, std::int32_t stride,
+                                    std::int32_t skip, F&& visit) {
+    const auto dim = brick.origin.size();
+    std::vector<std::int32_t> first(dim);
+    for (std::size_t d = 0; d < dim; ++d) {
+      first[d] = (brick.origin[d] + stride - 1) / stride * stride;
+      if (first[d] >= brick.origin[d] + brick.extent[d]) return;
+    }
+
+    auto ijk = first;
+    for (;;) {
+      bool skipped = skip > 0;
+      for (std::size_t d = 0; skipped && d < dim; ++d)
+        skipped = ijk[d] % skip == 0;
+      if (!skipped) visit(static_cast<const std::vector<std::int32_t>&>(ijk));
+
+      std::size_t axis = 0;
+      for (; axis < dim; ++axis) {
+        ijk[axis] += stride;
+        if (ijk[axis] < brick.origin[axis] + brick.extent[axis]) break;
+        ijk[axis] = first[axis];
+      }
+      if (axis == dim) return;
+    }
+  }
+
+  /**
+   * Visit every cell of the brick.
+   */
+  template <typename F>
+  inline void for_each_cell(const Brick& brick, F&& visit) {
+    for_each_cell_strided(brick, 1, 0, std::forward<F>(visit));
+  }
+
+  /**
+   * Visit each row of the brick along the first axis, handing the
+   * visitor the absolute index of the row's first cell and the
+   * offset of that cell within the brick's own (dense) storage.
+   */
+  template <typename F>
+  inline void for_each_row(const Brick& brick, F&& visit) {
+    if (brick.origin.empty()) return;
+    Brick rows = brick;
+    rows.extent[0] = 1;
+    std::size_t local = 0;
+    const std::size_t row_length = brick.extent[0];
+    for_each_cell(rows, [&](const std::vector<std::int32_t>& ijk) {
+      visit(ijk, local);
+      local += row_length;
+    });
+  }
+
+  /**
+   * Non-owning view of a contiguous run of values.
+   */
+  template <typename T>
+  struct Span {
+    T* ptr = nullptr;
+    std::size_t count = 0;
+
+    Span() = default;
+    Span(T* p, std::size_t n) : ptr(p), count(n) {}
+
+    T* data() const { return ptr; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+    T& operator[](std::size_t i) const { return ptr[i]; }
+  };
+
+  /**
+   * Cuts a cube of cube_size^dimension cells into bricks.
+   */
+  class BrickLayout {
+    std::int32_t m_cube_size = 0;
+    std::int32_t m_dimension = 0;
+    std::int32_t m_brick_size = default_brick_size;
+    std::int32_t m_per_axis = 0;
+    std::size_t m_count = 0;
+
+   public:
+    BrickLayout() = default;
+    BrickLayout(std::int32_t cube_size, std::int32_t dimension,
+                std::int32_t brick_size = default_brick_size)
+        : m_cube_size(cube_size),
+          m_dimension(dimension),
+          m_brick_size(std::max<std::int32_t>(1, brick_size)) {
+      m_per_axis = (m_cube_size + m_brick_size - 1) / m_brick_size;
+      m_count = 1;
+      for (std::int32_t d = 0; d < m_dimension; ++d) m_count *= m_per_axis;
+    }
+
+    std::size_t size() const { return m_count; }
+    std::int32_t brick_size() const { return m_brick_size; }
+    std::int32_t bricks_per_axis() const { return m_per_axis; }
+    std::int32_t dimension() const { return m_dimension; }
+    std::int32_t cube_size() const { return m_cube_size; }
+
+    std::size_t cells() const {
+      std::size_t n = 1;
+      for (std::int32_t d = 0; d < m_dimension; ++d) n *= m_cube_size;
+      return n;
+    }
+
+    Brick operator[](brick_id_t id) const {
+      Brick brick;
+      brick.id = id;
+      brick.origin.resize(m_dimension);
+      brick.extent.resize(m_dimension);
+      for (std::int32_t d = 0; d < m_dimension; ++d) {
+        auto b = static_cast<std::int32_t>(id % m_per_axis);
+        id /= m_per_axis;
+        brick.origin[d] = b * m_brick_size;
+        brick.extent[d] =
+            std::min(m_brick_size, m_cube_size - brick.origin[d]);
+      }
+      return brick;
+    }
+  };
+}  // namespace mgs
@@ -0,0 +1,196 @@
+#include <brick_cache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace mgs {
+  namespace {
+    const std::uint32_t entry_magic = 0x4253474d;  // "MGSB"
+    const std::uint32_t entry_format = 1;
+    const char* const entry_extension = ".brick";
+
+    struct EntryHeader {
+      std::uint32_t magic = entry_magic;
+      std::uint32_t format = entry_format;
+      std::uint64_t key = 0;
+      std::uint64_t size = 0;  // of the payload
+    };
+
+    bool parse_key(const fs::path& path, std::uint64_t& key) {
+      if (path.extension() != entry_extension) return false;
+      auto stem = path.stem().string();
+      if (stem.size() != 16) return false;
+      char* end = nullptr;
+      key = std::strtoull(stem.c_str(), &end, 16);
+      return end == stem.c_str() + stem.size();
+    }
+  }  // namespace
+
+  BrickCache::BrickCache(fs::path directory, std::uint64_t capacity_bytes)
+      : m_directory(std::move(directory)), m_capacity(capacity_bytes) {
+    std::error_code ec;
+    fs::create_directories(m_directory, ec);
+
+    // the most recently used last, as far as the files tell
+    struct Found {
+      std::uint64_t key;
+      std::uint64_t size;
+      fs::file_time_type time;
+    };
+    std::vector<Found> found;
+    for (const auto& item : fs::directory_iterator(m_directory, ec)) {
+      std::uint64_t key;
+      if (!item.is_regular_file(ec) || !parse_key(item.path(), key)) continue;
+      found.push_back({key, item.file_size(ec), item.last_write_time(ec)});
+    }
+    std::sort(found.begin(), found.end(),
+              [](const Found& a, const Found& b) { return a.time < b.time; });
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (const auto& f : found) {
+      m_entries[f.key] =
+          Entry{f.size, m_recency.insert(m_recency.end(), f.key)};
+      m_bytes += f.size;
+    }
+    evict();
+  }
+
+  fs::path BrickCache::path_of(std::uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof name, "%016llx%s",
+                  static_cast<unsigned long long>(key), entry_extension);
+    return m_directory / name;
+  }
+
+  bool BrickCache::load(std::uint64_t key, std::vector<std::uint8_t>& payload,
+                        std::size_t expected_size) {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      auto at = m_entries.find(key);
+      if (at == m_entries.end()) {
+        ++m_stats.misses;
+        return false;
+      }
+      m_recency.splice(m_recency.end(), m_recency, at->second.used);
+    }
+
+    // an entry evicted meanwhile stays readable while open
+    auto path = path_of(key);
+    std::ifstream in(path, std::ios::binary);
+    EntryHeader header;
+    bool good =
+        in.read(reinterpret_cast<char*>(&header), sizeof header) &&
+        header.magic == entry_magic && header.format == entry_format &&
+        header.key == key && header.size == expected_size;
+    if (good) {
+      payload.resize(expected_size);
+      good = bool(in.read(reinterpret_cast<char*>(payload.data()),
+                          expected_size));
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (!good) {
+      ++m_stats.misses;
+      forget(key);
+      return false;
+    }
+    ++m_stats.hits;
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+  }
+
+  bool BrickCache::contains(std::uint64_t key) const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_entries.count(key) != 0;
+  }
+
+  void BrickCache::store(std::uint64_t key, const std::uint8_t* payload,
+                         std::size_t size) {
+    std::uint64_t temporary;
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      temporary = ++m_temporaries;
+    }
+    std::ostringstream name;
+    name << path_of(key).filename().string() << ".tmp" << temporary;
+    auto aside = m_directory / name.str();
+
+    EntryHeader header;
+    header.key = key;
+    header.size = size;
+    {
+      std::ofstream out(aside, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&header), sizeof header);
+      out.write(reinterpret_cast<const char*>(payload), size);
+      if (!out) {
+        std::error_code ec;
+        fs::remove(aside, ec);
+        return;
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::error_code ec;
+    fs::rename(aside, path_of(key), ec);
+    if (ec) {
+      fs::remove(aside, ec);
+      return;
+    }
+    auto at = m_entries.find(key);
+    if (at == m_entries.end())
+      at = m_entries
+               .emplace(key, Entry{0, m_recency.insert(m_recency.end(), key)})
+               .first;
+    else
+      m_recency.splice(m_recency.end(), m_recency, at->second.used);
+    m_bytes -= at->second.size;
+    at->second.size = sizeof header + size;
+    m_bytes += at->second.size;
+    ++m_stats.stores;
+    evict();
+  }
+
+  void BrickCache::clear() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    while (!m_entries.empty()) forget(m_entries.begin()->first);
+  }
+
+  std::uint64_t BrickCache::bytes() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_bytes;
+  }
+
+  std::size_t BrickCache::entries() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_entries.size();
+  }
+
+  BrickCacheStats BrickCache::stats() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_stats;
+  }
+
+  void BrickCache::forget(std::uint64_t key) {
+    auto at = m_entries.find(key);
+    if (at == m_entries.end()) return;
+    m_bytes -= at->second.size;
+    m_recency.erase(at->second.used);
+    m_entries.erase(at);
+    std::error_code ec;
+    fs::remove(path_of(key), ec);
+  }
+
+  void BrickCache::evict() {
+    while (m_bytes > m_capacity && !m_recency.empty()) {
+      forget(m_recency.front());
+      ++m_stats.evictions;
+    }
+  }
+}  // namespace mgs
@@ -0,0 +1,104 @@
+#pragma once
+
+/**
+ * Content-addressed disk cache of rendered bricks.
+ *
+ * Each entry is one brick's worth of results (its iteration counts
+ * and channel values) in a file of its own, named after its key. The
+ * key is a hash of everything the values depend on (see
+ * Field::brick_key()), so an entry can never be stale: change the
+ * stars, the parameters or the integrator, and the keys change with
+ * them. Bricks are keyed by where their cells lie rather than by the
+ * field they came from, so a field whose lattice lines up with an
+ * earlier one's, such as a zoom into part of it at the same
+ * resolution, picks up the bricks they share.
+ *
+ * The cache is bounded in size, evicting the least recently used
+ * entries beyond it. Recency survives restarts through the files'
+ * modification times, which a hit brings up to date.
+ *
+ * A BrickCache may be shared by any number of renders at once;
+ * handed to a render through RenderOptions::cache, the render's
+ * workers read the bricks it has instead of computing them, and
+ * store those it had not.
+ */
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mgs {
+  const std::uint64_t default_brick_cache_capacity = std::uint64_t(1) << 30;
+
+  // bump whenever the numbers a render produces change
+  const std::uint32_t kernel_version = 1;
+
+  struct BrickCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t stores = 0;
+    std::uint64_t evictions = 0;
+  };
+
+  class BrickCache {
+   public:
+    /**
+     * Opens (creating if need be) the cache in the given directory,
+     * taking stock of the entries already there and evicting down
+     * to the capacity.
+     */
+    explicit BrickCache(
+        std::filesystem::path directory,
+        std::uint64_t capacity_bytes = default_brick_cache_capacity);
+
+    BrickCache(const BrickCache&) = delete;
+    BrickCache& operator=(const BrickCache&) = delete;
+
+    /**
+     * Reads the entry for the key into payload, if there is one of
+     * the expected size. A damaged entry is dropped as a miss.
+     */
+    bool load(std::uint64_t key, std::vector<std::uint8_t>& payload,
+              std::size_t expected_size);
+
+    bool contains(std::uint64_t key) const;
+
+    /**
+     * Writes the entry for the key, replacing any, then evicts as
+     * need be. The file is written aside and renamed into place, so
+     * a reader never sees it half done.
+     */
+    void store(std::uint64_t key, const std::uint8_t* payload,
+               std::size_t size);
+
+    void clear();
+
+    std::uint64_t bytes() const;
+    std::size_t entries() const;
+    std::uint64_t capacity() const { return m_capacity; }
+    BrickCacheStats stats() const;
+    const std::filesystem::path& directory() const { return m_directory; }
+
+   private:
+    struct Entry {
+      std::uint64_t size = 0;  // of the file
+      std::list<std::uint64_t>::iterator used;
+    };
+
+    std::filesystem::path m_directory;
+    std::uint64_t m_capacity;
+    mutable std::mutex m_lock;
+    std::unordered_map<std::uint64_t, Entry> m_entries;
+    std::list<std::uint64_t> m_recency;  // least recently used first
+    std::uint64_t m_bytes = 0;
+    std::uint64_t m_temporaries = 0;
+    BrickCacheStats m_stats;
+
+    std::filesystem::path path_of(std::uint64_t key) const;
+    void forget(std::uint64_t key);  // with the lock held
+    void evict();                    // likewise
+  };
+}  // namespace mgs
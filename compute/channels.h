@@ -0,0 +1,390 @@
+#pragma once
+
+/**
+ * Opt-in per-cell output channels.
+ *
+ * Field::grid holds the iteration count of every cell. Anything else
+ * a render can tell about a cell's orbit goes to a channel, each of
+ * which has to be asked for, and is stored in whichever compact form
+ * the job calls for:
+ *
+ *  + u8:  quantised linearly over the channel's range (lo to hi),
+ *         clamped; 0 for cells not rendered;
+ *  + f16: IEEE half precision; NaN for cells not rendered;
+ *  + f32: float; NaN for cells not rendered.
+ *
+ * A render with no channels requested does no more work, and touches
+ * no more memory, than one before channels existed. With channels,
+ * the workers gather the values of a brick in a per-thread buffer and
+ * write them back with the brick's rows, as they do for the grid.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "types.h"
+
+namespace mgs {
+  enum class ChannelKind : std::uint8_t {
+    final_speed,        // |v| when the orbit ended
+    min_star_distance,  // closest approach to any star
+    escape_direction,   // unit vector from the center, 0 if bound
+    captured_by,        // capturing star, not_captured if none
+    escape_time,        // fractional iteration count, see CellOutcome
+  };
+
+  enum class ChannelStorage : std::uint8_t { u8, f16, f32 };
+
+  inline const char* channel_name(ChannelKind kind) {
+    switch (kind) {
+      case ChannelKind::final_speed:
+        return "final_speed";
+      case ChannelKind::min_star_distance:
+        return "min_star_distance";
+      case ChannelKind::escape_direction:
+        return "escape_direction";
+      case ChannelKind::escape_time:
+        return "escape_time";
+      case ChannelKind::captured_by:
+      default:
+        return "captured_by";
+    }
+  }
+
+  inline int channel_components(ChannelKind kind) {
+    return kind == ChannelKind::escape_direction ? 3 : 1;
+  }
+
+  inline std::size_t storage_bytes(ChannelStorage storage) {
+    switch (storage) {
+      case ChannelStorage::u8:
+        return 1;
+      case ChannelStorage::f16:
+        return 2;
+      case ChannelStorage::f32:
+      default:
+        return 4;
+    }
+  }
+
+  /**
+   * The range quantised to u8 by default. That of captured_by maps
+   * star indices to themselves plus one, so not_captured becomes 0.
+   * There is no good default for escape_time, which should be f32
+   * (or f16, for iteration limits of up to about 2000) anyway: give
+   * it a range of 0 to the iteration limit if it must be u8.
+   */
+  struct ChannelRange {
+    float lo = 0;
+    float hi = 1;
+  };
+
+  inline ChannelRange default_channel_range(ChannelKind kind) {
+    switch (kind) {
+      case ChannelKind::escape_direction:
+        return {-1, 1};
+      case ChannelKind::captured_by:
+        return {float(not_captured), float(not_captured) + 255};
+      case ChannelKind::escape_time:
+        return {0, 255};
+      case ChannelKind::final_speed:
+      case ChannelKind::min_star_distance:
+      default:
+        return {0, 4};
+    }
+  }
+
+  /**
+   * IEEE 754 binary16 conversions, rounding to nearest even.
+   */
+  inline std::uint16_t float_to_half(float f) {
+    std::uint32_t x;
+    std::memcpy(&x, &f, sizeof x);
+    const std::uint32_t sign = (x >> 16) & 0x8000;
+    const std::uint32_t abs = x & 0x7fffffff;
+    if (abs >= 0x7f800000)  // inf or NaN
+      return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    if (abs >= 0x477ff000)  // rounds beyond the largest half
+      return sign | 0x7c00;
+    if (abs < 0x38800000) {  // subnormal half, or zero
+      if (abs < 0x33000000) return sign;
+      const std::uint32_t shift = 126 - (abs >> 23);
+      const std::uint32_t mant = (abs & 0x7fffff) | 0x800000;
+      std::uint32_t h = mant >> shift;
+      const std::uint32_t rest = mant & ((1u << shift) - 1);
+      const std::uint32_t half = 1u << (shift - 1);
+      if (rest > half || (rest == half && (h & 1))) ++h;
+      return sign | h;
+    }
+    std::uint32_t h = (abs - 0x38000000) >> 13;
+    const std::uint32_t rest = abs & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) ++h;
+    return sign | h;
+  }
+
+  inline float half_to_float(std::uint16_t h) {
+    const std::uint32_t sign = std::uint32_t(h & 0x8000) << 16;
+    std::uint32_t exp = (h >> 10) & 0x1f;
+    std::uint32_t mant = h & 0x3ff;
+    std::uint32_t x;
+    if (exp == 0x1f) {
+      x = sign | 0x7f800000 | (mant << 13);
+    } else if (exp == 0) {
+      if (mant == 0) {
+        x = sign;
+      } else {  // subnormal: normalise it
+        exp = 113;
+        while (!(mant & 0x400)) {
+          mant <<= 1;
+          --exp;
+        }
+        x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+      }
+    } else {
+      x = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof f);
+    return f;
+  }
+
+  /**
+   * One channel's values for every cell, components interleaved,
+   * in the same cell order as Field::grid.
+   */
+  class Channel {
+   public:
+    Channel(ChannelKind kind, ChannelStorage storage, ChannelRange range)
+        : m_kind(kind),
+          m_storage(storage),
+          m_components(channel_components(kind)),
+          m_range(range) {}
+
+    ChannelKind kind() const { return m_kind; }
+    ChannelStorage storage() const { return m_storage; }
+    int components() const { return m_components; }
+    ChannelRange range() const { return m_range; }
+    std::size_t cells() const {
+      return m_data.size() / (m_components * storage_bytes(m_storage));
+    }
+    std::size_t bytes() const { return m_data.size(); }
+    const std::uint8_t* data() const { return m_data.data(); }
+    // as stored, e.g. by another process
+    void assign(const std::uint8_t* bytes, std::size_t size) {
+      m_data.assign(bytes, bytes + size);
+    }
+
+    /**
+     * Resizes the channel to the given number of cells, all of them
+     * not rendered.
+     */
+    void allocate(std::size_t cells) {
+      m_data.assign(cells * m_components * storage_bytes(m_storage), 0);
+      if (m_storage != ChannelStorage::u8) {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        for (std::size_t i = 0; i < cells * m_components; ++i) put(i, nan);
+      }
+    }
+
+    float get(std::size_t cell, int component = 0) const {
+      const std::size_t i = cell * m_components + component;
+      switch (m_storage) {
+        case ChannelStorage::u8:
+          return m_range.lo +
+                 m_data[i] * ((m_range.hi - m_range.lo) / 255.0f);
+        case ChannelStorage::f16: {
+          std::uint16_t h;
+          std::memcpy(&h, &m_data[i * 2], sizeof h);
+          return half_to_float(h);
+        }
+        case ChannelStorage::f32:
+        default: {
+          float f;
+          std::memcpy(&f, &m_data[i * 4], sizeof f);
+          return f;
+        }
+      }
+    }
+
+    /**
+     * Stores count cells' worth of values (components interleaved)
+     * from cell on, as from a row of a brick.
+     */
+    void store(std::size_t cell, const float* values, std::size_t count) {
+      const std::size_t first = cell * m_components;
+      for (std::size_t i = 0; i < count * m_components; ++i)
+        put(first + i, values[i]);
+    }
+
+    /**
+     * The reverse of store(), for re-reading cells a render will
+     * leave alone.
+     */
+    void load(std::size_t cell, float* values, std::size_t count) const {
+      for (std::size_t c = 0; c < count; ++c)
+        for (int k = 0; k < m_components; ++k)
+          values[c * m_components + k] = get(cell + c, k);
+    }
+
+   private:
+    ChannelKind m_kind;
+    ChannelStorage m_storage;
+    int m_components;
+    ChannelRange m_range;
+    std::vector<std::uint8_t> m_data;
+
+    inline void put(std::size_t i, float v) {
+      switch (m_storage) {
+        case ChannelStorage::u8: {
+          float q = (v - m_range.lo) / (m_range.hi - m_range.lo) * 255.0f;
+          m_data[i] = std::isnan(q) ? 0
+                                    : static_cast<std::uint8_t>(std::lround(
+                                          std::clamp(q, 0.0f, 255.0f)));
+          break;
+        }
+        case ChannelStorage::f16: {
+          std::uint16_t h = float_to_half(v);
+          std::memcpy(&m_data[i * 2], &h, sizeof h);
+          break;
+        }
+        case ChannelStorage::f32:
+        default:
+          std::memcpy(&m_data[i * 4], &v, sizeof v);
+          break;
+      }
+    }
+  };
+
+  /**
+   * The channels a Field's renders are to fill, at most one of each
+   * kind.
+   */
+  class ChannelSet {
+   public:
+    /**
+     * Asks for a channel, replacing any of the same kind. It is
+     * allocated at the start of the next render.
+     */
+    Channel& request(ChannelKind kind,
+                     ChannelStorage storage = ChannelStorage::f32) {
+      return request(kind, storage, default_channel_range(kind));
+    }
+    Channel& request(ChannelKind kind, ChannelStorage storage,
+                     ChannelRange range) {
+      release(kind);
+      m_channels.emplace_back(kind, storage, range);
+      return m_channels.back();
+    }
+
+    void release(ChannelKind kind) {
+      m_channels.erase(
+          std::remove_if(m_channels.begin(), m_channels.end(),
+                         [&](const Channel& c) { return c.kind() == kind; }),
+          m_channels.end());
+    }
+
+    Channel* find(ChannelKind kind) {
+      for (auto& c : m_channels)
+        if (c.kind() == kind) return &c;
+      return nullptr;
+    }
+    const Channel* find(ChannelKind kind) const {
+      return const_cast<ChannelSet*>(this)->find(kind);
+    }
+
+    bool empty() const { return m_channels.empty(); }
+    std::size_t size() const { return m_channels.size(); }
+    std::vector<Channel>::iterator begin() { return m_channels.begin(); }
+    std::vector<Channel>::iterator end() { return m_channels.end(); }
+    std::vector<Channel>::const_iterator begin() const {
+      return m_channels.begin();
+    }
+    std::vector<Channel>::const_iterator end() const {
+      return m_channels.end();
+    }
+
+    // the values of all the channels for one cell, back to back
+    int components() const {
+      int n = 0;
+      for (const auto& c : m_channels) n += c.components();
+      return n;
+    }
+
+    std::size_t bytes() const {
+      std::size_t n = 0;
+      for (const auto& c : m_channels) n += c.bytes();
+      return n;
+    }
+
+   private:
+    std::vector<Channel> m_channels;
+  };
+
+  /**
+   * The step observer gathering a cell's channel values, for an FPM
+   * starting at p in vector type V. It only does the work of the
+   * channels asked for.
+   */
+  template <typename T, typename V>
+  struct ChannelRecorder {
+    const std::vector<V>& stars;
+    bool track_distance;
+    V p, v;
+    T min_distance_squared = std::numeric_limits<T>::infinity();
+
+    ChannelRecorder(const std::vector<V>& star_positions, bool distance,
+                    const V& p0, const V& v0)
+        : stars(star_positions), track_distance(distance), p(p0), v(v0) {
+      if (track_distance) closest(p0);
+    }
+
+    inline void operator()(const V& p_, const V& v_) {
+      p = p_;
+      v = v_;
+      if (track_distance) closest(p_);
+    }
+
+    /**
+     * Writes the values of the channels, in their order, to out,
+     * given how the orbit ended.
+     */
+    void emit(const ChannelSet& channels, const V& center, bool escaped,
+              const CellOutcome<T>& outcome, float* out) const {
+      for (const auto& c : channels) {
+        switch (c.kind()) {
+          case ChannelKind::final_speed:
+            *out++ = static_cast<float>(v.norm());
+            break;
+          case ChannelKind::min_star_distance:
+            *out++ = static_cast<float>(std::sqrt(min_distance_squared));
+            break;
+          case ChannelKind::escape_direction: {
+            auto r = p - center;
+            T norm = r.norm();
+            for (indexer_t d = 0; d < 3; ++d)
+                *out++ = escaped && norm > 0 ? static_cast<float>(r[d] / norm)
+                                           : 0.0f;
+            break;
+          }
+          case ChannelKind::captured_by:
+            *out++ = static_cast<float>(outcome.captured_by);
+            break;
+          case ChannelKind::escape_time:
+            *out++ = static_cast<float>(outcome.escape_time);
+            break;
+        }
+      }
+    }
+
+   private:
+    inline void closest(const V& at) {
+      for (const auto& s : stars)
+        min_distance_squared =
+            std::min(min_distance_squared, T((at - s).norm_squared()));
+    }
+  };
+}  // namespace mgs
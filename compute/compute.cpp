@@ -1,16 +1,733 @@
 #include <compute.h>
+#include <adaptive.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
 namespace mgs {
   extern "C++" {
-    
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::render_with_callback(
+        cell_callback_t cb, const RenderOptions& options) {
+      launch_render(std::move(cb), nullptr, options, true);
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    RenderJob Field<T, Interant, Indexer, P>::render_async(
+        cell_callback_t cb, const RenderOptions& options) {
+      return launch_render(std::move(cb), nullptr, options);
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::render_with_brick_callback(
+        brick_callback_t cb, const RenderOptions& options) {
+      launch_render(nullptr, std::move(cb), options, true);
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    RenderJob Field<T, Interant, Indexer, P>::render_bricks_async(
+        brick_callback_t cb, const RenderOptions& options) {
+      return launch_render(nullptr, std::move(cb), options);
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    std::uint64_t Field<T, Interant, Indexer, P>::signature(
+        bool with_iter_limit) const {
+      Signature sig;
+      for (auto x : box.nm.vec) sig.add(x);
+      for (auto x : box.pm.vec) sig.add(x);
+      sig.add(cube_size).add(dimension);
+      add_physics(sig, with_iter_limit);
+      return sig.value();
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::add_physics(
+        Signature& sig, bool with_iter_limit) const {
+      for (const auto& star : stars) {
+        sig.add(star.mass).add(star.capture_radius);
+        for (auto x : star.position.vec) sig.add(x);
+      }
+      sig.add(parms.gravitational_constant)
+          .add(parms.delta_t)
+          .add(parms.escape_radius)
+          .add(parms.integrator)
+          .add(parms.adaptive)
+          .add(parms.adaptive_eta)
+          .add(parms.kepler_tolerance)
+          .add(parms.force_law)
+          .add(parms.softening)
+          .add(parms.force_exponent)
+          .add(parms.opening_angle)
+          .add(parms.accel_grid_size)
+          .add(parms.accel_interpolation)
+          .add(parms.accel_guard_radius)
+          .add(parms.capture_radius);
+      if (with_iter_limit) sig.add(parms.iter_limit);
+      for (const auto& channel : channels) {
+        auto range = channel.range();
+        sig.add(channel.kind()).add(channel.storage());
+        sig.add(range.lo).add(range.hi);
+      }
+    }
+
     template <typename T, typename Interant, typename Indexer, typename P>
-    void Field<T,Interant,Indexer,P>::render_with_callback(std::function<void(Index, Position)> cb) {
+    std::uint64_t Field<T, Interant, Indexer, P>::brick_key(
+        const Brick& brick) const {
+      const double phase_quantum = 1e6;
+      // fine enough that a million cells along, the lattices of two
+      // spacings keyed the same are still within the phase quantum
+      const double spacing_quantum = 1e12;
+      Signature sig;
+      sig.add(kernel_version).add(sizeof(Interant)).add(dimension);
+      add_physics(sig, true);
+      if (parms.accel_grid_size > 0) {
+        for (auto x : box.nm.vec) sig.add(x);
+        for (auto x : box.pm.vec) sig.add(x);
+      }
+      for (Indexer d = 0; d < Indexer(box.nm.vec.size()); ++d) {
+        if (d >= dimension || cube_size <= 1) {
+          sig.add((box.nm[d] + box.pm[d]) / 2.0);
+          continue;
+        }
+        const double spacing = (box.pm[d] - box.nm[d]) / (cube_size - 1);
+        const double at = box.nm[d] / spacing;
+        auto lattice = static_cast<long long>(std::floor(at));
+        auto phase = std::llround((at - lattice) * phase_quantum);
+        if (phase == std::llround(phase_quantum)) {
+          phase = 0;
+          ++lattice;
+        }
+        int exponent = 0;
+        const double mantissa = std::frexp(spacing, &exponent);
+        sig.add(exponent)
+            .add(std::llround(mantissa * spacing_quantum))
+            .add(phase)
+            .add(lattice + brick.origin[d])
+            .add(brick.extent[d]);
+      }
+      return sig.value();
+    }
+
+    /**
+     * What every render needs before the workers start, and then
+     * only reads.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::prepare_render(std::size_t bricks,
+                                                        bool anytime) {
       center_of_star_mass = compute_center_of_star_mass<T,Indexer>(stars);
+      if (parms.opening_angle > 0)
+        star_tree = std::make_shared<StarTree<T>>(stars, parms.opening_angle,
+                                                  parms.capture_radius);
+      else
+        star_tree.reset();
+      accel_grid.reset();
+      for (auto& channel : channels)
+        if (channel.cells() != grid.size()) channel.allocate(grid.size());
+      m_cache.reset();
+      m_resume_from = static_cast<Interant>(
+          resume.begin(signature(false), parms.iter_limit, bricks,
+                       !parms.adaptive && !anytime));
+      // any other render leaves nothing for an anytime one to go on with
+      if (!anytime) m_anytime_signature = 0;
+    }
+
+    /**
+     * Run from within the render job, on its workers, as the table
+     * may take a while. It spans the render bounds.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::build_accel_grid(
+        unsigned threads, const CancelToken& token, ThreadPool* pool) {
+      if (parms.accel_grid_size <= 0) return;
+      Vec3<T> lo(box.nm), hi(box.pm);
+      with_star_kernel(
+          stars, center_of_star_mass, parms,
+          [&](const auto& exact) {
+            auto table = std::make_shared<AccelGrid<T>>(
+                exact, stars, lo, hi, parms.accel_grid_size,
+                parms.accel_interpolation, parms.accel_guard_radius, threads,
+                token, pool);
+            if (table->complete()) accel_grid = std::move(table);
+          },
+          star_tree.get());
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    std::vector<double> Field<T, Interant, Indexer, P>::estimate_brick_costs(
+        const BrickLayout& layout, unsigned threads, const CancelToken& token,
+        ThreadPool* pool) {
+      std::vector<double> costs(layout.size(), 0.0);
+      auto coarse = parms;
+      coarse.iter_limit = std::min<Interant>(parms.iter_limit,
+                                             Interant(estimate_iter_limit));
+      with_integrator(parms.integrator, [&](auto integrator) {
+        using Integrator = decltype(integrator);
+        with_star_kernel(
+            stars, center_of_star_mass, parms,
+            [&](const auto& kernel) {
+              using V = typename std::decay_t<decltype(kernel)>::vector_type;
+              const V center(center_of_star_mass);
+              for_each_brick_parallel(
+                  layout.size(), threads, token, [&](brick_id_t b) {
+                    Brick brick = layout[b];
+                    const std::size_t dim = brick.origin.size();
+                    const unsigned samples = 1u << dim;
+                    double steps = 0;
+                    // a quarter of the way in from either side
+                    for (unsigned corner = 0; corner < samples; ++corner) {
+                      idx_vector_t ijk(dim);
+                      for (std::size_t d = 0; d < dim; ++d)
+                        ijk[d] = brick.origin[d] +
+                                 (corner >> d & 1 ? 3 * brick.extent[d] / 4
+                                                  : brick.extent[d] / 4);
+                      std::size_t taken = 0;
+                      auto count = [&](const V&, const V&) { ++taken; };
+                      CellOutcome<T> outcome;
+                      auto iters = integrate_cell<T, Interant, Integrator>(
+                          V(cell_position(ijk)), V{}, kernel, center, coarse,
+                          count, &outcome);
+                      double cost = 1 + taken;
+                      if (iters >= coarse.iter_limit &&
+                          outcome.captured_by == not_captured)
+                        cost *= double(parms.iter_limit) /
+                                std::max<Interant>(coarse.iter_limit, 1);
+                      steps += cost;
+                    }
+                    costs[b] = steps / samples * brick.cells();
+                  },
+                  nullptr, pool);
+            },
+            star_tree.get());
+      });
+      return costs;
+    }
+
+    /**
+     * The brick costs the schedule needs, if any, timed into the
+     * job's report.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    std::vector<double> Field<T, Interant, Indexer, P>::schedule_costs(
+        BrickSchedule schedule, const BrickLayout& layout, unsigned threads,
+        RenderJobState& state, ThreadPool* pool) {
+      if (schedule != BrickSchedule::longest_first) return {};
+      auto started = RenderJobState::clock::now();
+      auto costs = estimate_brick_costs(layout, threads, state.token, pool);
+      state.schedule.estimate_seconds =
+          std::chrono::duration<double>(RenderJobState::clock::now() - started)
+              .count();
+      return costs;
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    RenderJob Field<T, Interant, Indexer, P>::launch_render(
+        cell_callback_t cb, brick_callback_t bcb,
+        const RenderOptions& options, bool in_place) {
+      BrickLayout layout(cube_size, dimension, options.brick_size);
+      prepare_render(layout.size());
+      m_cache = options.cache;
+      auto threads = options.worker_count();
+
+      return RenderJob::launch(
+          layout.cells(), options.token,
+          [this, layout, threads, schedule = options.schedule,
+           pool = options.pool, cb = std::move(cb),
+           bcb = std::move(bcb)](RenderJobState& state) {
+            build_accel_grid(threads, state.token, pool.get());
+            auto costs =
+                schedule_costs(schedule, layout, threads, state, pool.get());
+            for_each_brick_scheduled(
+                layout.size(), costs, threads, state.token,
+                [&](brick_id_t b) {
+                  state.add_done(
+                      render_brick(layout[b], state.token, cb, bcb));
+                },
+                &state.schedule, pool.get());
+            resume.finish(!state.token.cancelled());
+          },
+          in_place);
     }
-    
-    
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    void Field<T, Interant, Indexer, P>::prepare_bricks(
+        const BrickLayout& layout, unsigned threads) {
+      prepare_render(layout.size());
+      build_accel_grid(threads, CancelToken{});
+    }
+
+    template <typename T, typename Interant, typename Indexer, typename P>
+    std::uint64_t Field<T, Interant, Indexer, P>::render_single_brick(
+        const Brick& brick, const brick_callback_t& cb,
+        const CancelToken& token) {
+      return render_brick(brick, token, nullptr, cb);
+    }
+
+    /**
+     * Each level is a full pass over the bricks, restricted to the
+     * cells on its stride that no coarser level has done already.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    RenderJob Field<T, Interant, Indexer, P>::render_progressive(
+        const std::vector<LevelSubscriber>& subscribers, cell_callback_t cb,
+        const RenderOptions& options, Indexer coarsest_stride) {
+      BrickLayout layout(cube_size, dimension, options.brick_size);
+      prepare_render(layout.size());
+      auto threads = options.worker_count();
+      auto strides = level_strides(coarsest_stride);
+
+      return RenderJob::launch(
+          layout.cells(), options.token,
+          [this, layout, threads, strides, subscribers,
+           schedule = options.schedule, pool = options.pool,
+           cb = std::move(cb)](RenderJobState& state) {
+            build_accel_grid(threads, state.token, pool.get());
+            auto costs =
+                schedule_costs(schedule, layout, threads, state, pool.get());
+            Indexer skip = 0;
+            for (std::size_t level = 0; level < strides.size(); ++level) {
+              auto stride = strides[level];
+              for_each_brick_scheduled(
+                  layout.size(), costs, threads, state.token,
+                  [&](brick_id_t b) {
+                    state.add_done(render_brick(layout[b], state.token, cb,
+                                                nullptr, stride, skip));
+                  },
+                  &state.schedule, pool.get());
+              if (state.token.cancelled()) {
+                resume.finish(false);
+                return;
+              }
+              if (level + 1 == strides.size()) resume.finish(true);
+
+              LevelUpdate update;
+              update.stride = stride;
+              update.level = level;
+              update.levels = strides.size();
+              update.cells_done = state.cells_done.load();
+              for (auto& sub : subscribers) sub->try_push(update);
+              skip = stride;
+            }
+          });
+    }
+
+    /**
+     * How much rendering the brick at the next level stands to gain,
+     * by its cells on the coarser stride (and those just around it);
+     * see anytime.h. 0 for a flat brick outside the region of
+     * interest.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    double Field<T, Interant, Indexer, P>::brick_priority(
+        const Brick& brick, Indexer coarser_stride,
+        const std::optional<Bounds>& roi) const {
+      Brick around = brick;
+      for (Indexer d = 0; d < dimension; ++d) {
+        around.origin[d] = std::max(0, brick.origin[d] - coarser_stride);
+        around.extent[d] =
+            std::min(cube_size, brick.origin[d] + brick.extent[d] +
+                                    coarser_stride) -
+            around.origin[d];
+      }
+      Interant lo = std::numeric_limits<Interant>::max();
+      Interant hi = std::numeric_limits<Interant>::min();
+      for_each_cell_strided(around, coarser_stride, 0,
+                            [&](const idx_vector_t& ijk) {
+                              auto value = grid[offset(ijk)];
+                              if (value == Interant(untouched)) return;
+                              lo = std::min(lo, value);
+                              hi = std::max(hi, value);
+                            });
+      double priority = 0;
+      if (hi > lo) priority += 2 + double(hi - lo) / parms.iter_limit;
+
+      if (roi) {
+        idx_vector_t last(brick.origin);
+        for (Indexer d = 0; d < dimension; ++d)
+          last[d] += brick.extent[d] - 1;
+        auto from = cell_position(brick.origin);
+        auto to = cell_position(last);
+        bool overlaps = true;
+        for (Indexer d = 0; d < dimension; ++d)
+          overlaps &= from[d] <= roi->pm[d] && to[d] >= roi->nm[d];
+        if (overlaps) priority += 1;
+      }
+      return priority;
+    }
+
+    /**
+     * The bricks of each level are taken by priority, those of none
+     * being left to a second sweep. The job's own token is cancelled
+     * at the deadline, or as soon as the caller's is.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    AnytimeResult Field<T, Interant, Indexer, P>::render_anytime(
+        const AnytimeOptions& anytime, const RenderOptions& options) {
+      using clock = AnytimeOptions::clock;
+      const auto started = clock::now();
+      const auto deadline = anytime.until(started);
+
+      // carry on only from an anytime render of this very field
+      const auto sig = signature();
+      if (sig != m_anytime_signature) {
+        std::fill(grid.begin(), grid.end(), Interant(untouched));
+        for (auto& channel : channels) channel.allocate(grid.size());
+      }
+      BrickLayout layout(cube_size, dimension, options.brick_size);
+      prepare_render(layout.size(), true);
+      m_anytime_signature = sig;
+      m_fill_only = true;
+      const auto threads = options.worker_count();
+      const auto strides = level_strides(anytime.coarsest_stride);
+      const CancelToken caller = options.token;
+
+      auto job = RenderJob::launch(
+          layout.cells(), CancelToken{}, [&](RenderJobState& state) {
+            std::mutex lock;
+            std::condition_variable wake;
+            bool over = false;
+            std::thread watchdog([&] {
+              std::unique_lock<std::mutex> guard(lock);
+              while (!over) {
+                auto now = clock::now();
+                if (now >= deadline || caller.cancelled()) {
+                  state.token.cancel();
+                  return;
+                }
+                wake.wait_until(guard,
+                                std::min(deadline, now + anytime_poll));
+              }
+            });
+
+            auto run = [&](const std::vector<brick_id_t>& bricks,
+                           const std::vector<double>& priorities,
+                           Indexer stride, Indexer skip) {
+              for_each_brick_longest_first(
+                  priorities, threads, state.token,
+                  [&](brick_id_t i) {
+                    state.add_done(render_brick(layout[bricks[i]],
+                                                state.token, nullptr, nullptr,
+                                                stride, skip));
+                  },
+                  &state.schedule, options.pool.get());
+            };
+
+            build_accel_grid(threads, state.token, options.pool.get());
+            std::vector<std::vector<brick_id_t>> deferred(strides.size());
+            Indexer skip = 0;
+            for (std::size_t level = 0; level < strides.size(); ++level) {
+              std::vector<brick_id_t> bricks;
+              std::vector<double> priorities;
+              for (brick_id_t b = 0; b < layout.size(); ++b) {
+                double priority =
+                    level == 0 ? 1 : brick_priority(layout[b], skip,
+                                                    anytime.region_of_interest);
+                if (priority > 0) {
+                  bricks.push_back(b);
+                  priorities.push_back(priority);
+                } else {
+                  deferred[level].push_back(b);
+                }
+              }
+              run(bricks, priorities, strides[level], skip);
+              skip = strides[level];
+            }
+            skip = 0;
+            for (std::size_t level = 0; level < strides.size(); ++level) {
+              run(deferred[level],
+                  std::vector<double>(deferred[level].size(), 1.0),
+                  strides[level], skip);
+              skip = strides[level];
+            }
+
+            {
+              std::lock_guard<std::mutex> guard(lock);
+              over = true;
+            }
+            wake.notify_all();
+            watchdog.join();
+          });
+      job.wait();
+      m_fill_only = false;
+
+      AnytimeResult result;
+      result.cells_total = grid.size();
+      result.cells_done = grid.size() - std::count(grid.begin(), grid.end(),
+                                                   Interant(untouched));
+      result.status = result.cells_done == result.cells_total
+                          ? RenderStatus::completed
+                          : RenderStatus::cancelled;
+      Brick whole;
+      whole.origin.assign(dimension, 0);
+      whole.extent.assign(dimension, cube_size);
+      for (auto stride : strides) {
+        bool done = true;
+        for_each_cell_strided(whole, stride, 0, [&](const idx_vector_t& ijk) {
+          done &= grid[offset(ijk)] != Interant(untouched);
+        });
+        if (!done) break;
+        result.complete_stride = stride;
+      }
+      result.seconds =
+          std::chrono::duration<double>(clock::now() - started).count();
+      return result;
+    }
+
+    /**
+     * Renders the cells of the brick on the given stride (all of
+     * them by default) into a dense per-thread brick buffer, which
+     * is then written back to the grid a row at a time and handed to
+     * the brick callback. The channels asked for, if any, go the
+     * same way through a buffer of their own. Returns the number of
+     * cells done. The token is checked per cell, so a cancelled brick
+     * is left partially untouched (and is not handed to the brick
+     * callback). A whole brick rendered afresh is first looked up in
+     * the render's cache, if it has one, and stored there if missing.
+     */
+    template <typename T, typename Interant, typename Indexer, typename P>
+    std::uint64_t Field<T, Interant, Indexer, P>::render_brick(
+        const Brick& brick, const CancelToken& token,
+        const cell_callback_t& cb, const brick_callback_t& bcb,
+        Indexer stride, Indexer skip) {
+      thread_local std::vector<Interant> buffer;
+      const std::size_t row_length = brick.extent[0];
+      const std::size_t cells = brick.cells();
+      buffer.resize(cells);
+
+      // the channels' values for the brick, one channel after another
+      thread_local std::vector<float> channel_buffer;
+      thread_local std::vector<std::size_t> channel_base;
+      const bool with_channels = !channels.empty();
+      if (with_channels) {
+        channel_buffer.resize(cells * channels.components());
+        channel_base.clear();
+        std::size_t base = 0;
+        for (const auto& channel : channels) {
+          channel_base.push_back(base);
+          base += cells * channel.components();
+        }
+      }
+      auto for_each_channel_row = [&](const idx_vector_t& row,
+                                      std::size_t local, auto&& visit) {
+        std::size_t c = 0;
+        for (auto& channel : channels) {
+          float* values =
+              &channel_buffer[channel_base[c++] + local * channel.components()];
+          visit(channel, offset(row), values);
+        }
+      };
+
+      auto write_back = [&] {
+        for_each_row(brick, [&](const idx_vector_t& row, std::size_t local) {
+          std::copy_n(buffer.cbegin() + local, row_length,
+                      grid.begin() + offset(row));
+          if (with_channels)
+            for_each_channel_row(row, local, [&](auto& channel, auto at,
+                                                 float* values) {
+              channel.store(at, values, row_length);
+            });
+        });
+      };
+
+      // only whole bricks rendered afresh go through the cache
+      const bool cacheable = m_cache && stride == 1 && skip == 0 &&
+                             !m_resume_from && !m_fill_only &&
+                             !resume.recording();
+      const std::size_t buffer_bytes = cells * sizeof(Interant);
+      const std::size_t payload_bytes =
+          buffer_bytes + (with_channels ? channel_buffer.size() : 0) *
+                             sizeof(float);
+      std::uint64_t key = 0;
+      thread_local std::vector<std::uint8_t> payload;
+      if (cacheable) {
+        key = brick_key(brick);
+        if (m_cache->load(key, payload, payload_bytes)) {
+          std::memcpy(buffer.data(), payload.data(), buffer_bytes);
+          if (with_channels)
+            std::memcpy(channel_buffer.data(), payload.data() + buffer_bytes,
+                        payload_bytes - buffer_bytes);
+          write_back();
+          if (cb)
+            for_each_cell_strided(brick, 1, 0, [&](const idx_vector_t& ijk) {
+              cb(Index(ijk), cell_position(ijk));
+            });
+          if (bcb && !token.cancelled())
+            bcb(brick, Span<const Interant>(buffer.data(), buffer.size()));
+          return cells;
+        }
+      }
+
+      // cells not on this level, or not resumed, or already done for
+      // an anytime render, keep whatever the grid already has
+      if (stride > 1 || skip > 0 || m_resume_from || m_fill_only) {
+        for_each_row(brick, [&](const idx_vector_t& row, std::size_t local) {
+          auto from = grid.cbegin() + offset(row);
+          std::copy(from, from + row_length, buffer.begin() + local);
+          if (with_channels)
+            for_each_channel_row(row, local, [&](auto& channel, auto at,
+                                                 float* values) {
+              channel.load(at, values, row_length);
+            });
+        });
+      } else {
+        std::fill(buffer.begin(), buffer.end(), Interant(untouched));
+        std::fill(channel_buffer.begin(), channel_buffer.end(),
+                  std::numeric_limits<float>::quiet_NaN());
+      }
+
+      std::uint64_t done = 0;
+      with_integrator(parms.integrator, [&](auto integrator) {
+        using Integrator = decltype(integrator);
+        auto render_cells = [&](const auto& kernel) {
+          using V = typename std::decay_t<decltype(kernel)>::vector_type;
+          const V center(center_of_star_mass);
+          const V initial_v{};
+
+          // only for the channels
+          std::vector<V> star_positions;
+          const bool track_distance =
+              channels.find(ChannelKind::min_star_distance) != nullptr;
+          if (track_distance)
+            for (const auto& star : stars)
+              star_positions.push_back(V(star.position));
+          std::vector<float> values(channels.components());
+
+          auto integrate = [&](const V& p0, const V& v0, auto&& observe,
+                               CellOutcome<T>* outcome, Interant first) {
+            return parms.adaptive
+                       ? integrate_cell_adaptive<T, Interant, Integrator>(
+                             p0, v0, kernel, center, parms, observe, outcome)
+                       : integrate_cell<T, Interant, Integrator>(
+                             p0, v0, kernel, center, parms, observe, outcome,
+                             first);
+          };
+          auto set_channel = [&](std::size_t local, ChannelKind kind,
+                                 float value) {
+            std::size_t c = 0;
+            for (const auto& channel : channels) {
+              if (channel.kind() == kind)
+                channel_buffer[channel_base[c] +
+                               local * channel.components()] = value;
+              ++c;
+            }
+          };
+
+          for_each_cell_strided(
+              brick, stride, skip, [&](const idx_vector_t& ijk) {
+                if (token.cancelled()) return;
+                auto p = cell_position(ijk);
+                std::size_t local = 0;
+                std::size_t r = 1;
+                for (Indexer d = 0; d < dimension; ++d) {
+                  local += (ijk[d] - brick.origin[d]) * r;
+                  r *= brick.extent[d];
+                }
+
+                // resuming, only the orbits the old limit stopped go on;
+                // those at it but not saved were captured
+                const typename ResumeTable<T>::Entry* saved = nullptr;
+                bool run = !m_fill_only || buffer[local] == Interant(untouched);
+                if (m_resume_from) {
+                  if (buffer[local] == m_resume_from)
+                    saved = resume.find(offset(ijk));
+                  run = saved != nullptr;
+                  if (!saved && buffer[local] == m_resume_from) {
+                    buffer[local] = parms.iter_limit;
+                    if (with_channels)
+                      set_channel(local, ChannelKind::escape_time,
+                                  parms.iter_limit);
+                  }
+                }
+
+                if (!run) {
+                  // keeps its count
+                } else if (with_channels || resume.recording()) {
+                  const V p0 = saved ? V(saved->p) : V(p);
+                  const V v0 = saved ? V(saved->v) : initial_v;
+                  const Interant first =
+                      saved ? static_cast<Interant>(saved->iterations) : 0;
+                  CellOutcome<T> outcome;
+                  ChannelRecorder<T, V> recorder(star_positions,
+                                                 track_distance, p0, v0);
+                  buffer[local] = integrate(p0, v0, recorder, &outcome, first);
+                  bool escaped = buffer[local] < parms.iter_limit;
+                  if (!escaped && outcome.captured_by == not_captured &&
+                      resume.recording())
+                    resume.record(brick.id,
+                                  {offset(ijk),
+                                   static_cast<std::int32_t>(outcome.reached),
+                                   Vec3<T>(recorder.p), Vec3<T>(recorder.v)});
+
+                  if (with_channels) {
+                    recorder.emit(channels, center, escaped, outcome,
+                                  values.data());
+                    std::size_t c = 0, k = 0;
+                    for (const auto& channel : channels) {
+                      float* to = &channel_buffer[channel_base[c++] +
+                                                  local * channel.components()];
+                      // the closest approach may have been before
+                      const bool before =
+                          saved &&
+                          channel.kind() == ChannelKind::min_star_distance &&
+                          !std::isnan(to[0]);
+                      for (int j = 0; j < channel.components(); ++j, ++k)
+                        to[j] = before ? std::min(to[j], values[k]) : values[k];
+                    }
+                  }
+                } else {
+                  buffer[local] =
+                      integrate(V(p), initial_v, NullObserver{}, nullptr, 0);
+                }
+                ++done;
+
+                if (cb) {
+                  grid[offset(ijk)] = buffer[local];
+                  if (with_channels)
+                    for_each_channel_row(ijk, local, [&](auto& channel, auto at,
+                                                         float* values) {
+                      channel.store(at, values, 1);
+                    });
+                  cb(Index(ijk), p);
+                }
+              });
+        };
+        with_star_kernel(
+            stars, center_of_star_mass, parms,
+            [&](const auto& exact) {
+              using Exact = std::decay_t<decltype(exact)>;
+              if (accel_grid)
+                render_cells(AccelGridKernel<T, Exact>(*accel_grid, exact));
+              else
+                render_cells(exact);
+            },
+            star_tree.get());
+      });
+
+      write_back();
+
+      if (cacheable && done == cells && !token.cancelled()) {
+        payload.resize(payload_bytes);
+        std::memcpy(payload.data(), buffer.data(), buffer_bytes);
+        if (with_channels)
+          std::memcpy(payload.data() + buffer_bytes, channel_buffer.data(),
+                      payload_bytes - buffer_bytes);
+        m_cache->store(key, payload.data(), payload_bytes);
+      }
+
+      if (bcb && !token.cancelled())
+        bcb(brick, Span<const Interant>(buffer.data(), buffer.size()));
+      return done;
+    }
+
     // so that StarField is instantiated in this library.
     // FIXME: This is a duplication of StarField.
     template struct Field<double, iterant_t, indexer_t, struct FieldParm>;
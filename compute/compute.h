@@ -8,326 +8,190 @@
  * other possibilities, but for now, we don't need.
  */
 
-#include <bitset>
 #include <cmath>
 #include <cstdint>
 #include <functional>
-#include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
-namespace mgs {
-  const int default_dimension = 3;
-  const int untouched = -1;
+#include "accel_grid.h"
+#include "anytime.h"
+#include "brick.h"
+#include "brick_cache.h"
+#include "channels.h"
+#include "integrators.h"
+#include "kepler.h"
+#include "octree.h"
+#include "progressive.h"
+#include "render_job.h"
+#include "resume.h"
+#include "scheduler.h"
+#include "signature.h"
+#include "star_kernels.h"
+#include "types.h"
+#include "vec3.h"
 
-  using indexer_t = std::int32_t;
-  using iterant_t = std::int16_t;
-  using idx_vector_t = std::vector<indexer_t>;
-  using floating_t = double;
+namespace mgs {
+  // the iteration limit of the brick cost pre-pass
+  const int estimate_iter_limit = 64;
 
   /**
-   * index_bits_t will increment the index according
-   * to the bits set. This is primarilary for the
-   * marching tetrahedra algorithm.
+   * The default step observer for render_single_cell(). It does
+   * nothing, and being a distinct type (rather than an empty
+   * std::function) the call to it vanishes altogether.
    */
-  using index_bits_t = std::bitset<3>;
-
-  struct Index {
-    idx_vector_t ijk;
-
-    Index(std::initializer_list<indexer_t> list) : ijk(list) {}
-    Index(const Index& other) : ijk(other.ijk) {}
-    Index(const Index&& other) : ijk(std::move(other.ijk)) {}
-
-    bool operator==(const Index& other) const {
-      return ijk == other.ijk;
-    }
-    
-    Index& operator=(const Index& other) {
-      ijk = other.ijk;
-      return *this;
-    }
-
-    Index& operator=(Index&& other) {
-      ijk = std::move(other.ijk);
-      return *this;
-    }
-
-    auto& operator[](const indexer_t& i) { return ijk[i]; }
-    auto operator[](const indexer_t& i) const { return ijk[i]; }
-    auto size() const { return ijk.size(); }
+  struct NullObserver {
+    template <typename... Args>
+    inline void operator()(const Args&...) const {}
   };
 
   /**
-   * For 3D MGS only, primarily for marching tetrahedra.
+   * Iterates a single Free Point Mass from initial position and
+   * velocity under the given acceleration kernel (see star_kernels.h),
+   * in whatever vector type the kernel works in. This is the loop at
+   * the heart of everything; render_single_cell() and the Field
+   * renders are built on it.
+   *
+   * An FPM captured by a star never escapes, so it is stopped there
+   * and then and counted as reaching the iteration limit. How the
+   * orbit ended, including the star that captured it and the smooth
+   * escape time, goes to outcome, if given.
+   *
+   * An orbit resumed from a saved state starts at first_iteration.
    */
-  inline Index operator+(const Index& source, const index_bits_t& bits) {
-    Index dest = source;
-    for (decltype(bits.size()) i{}; i < bits.size(); ++i) {
-      dest.ijk[i] += static_cast<indexer_t>(bits[i]);
-    }
-    return dest;
-  }
-
-  inline std::ostream& operator<<(std::ostream& os, Index const& idx) {
-    os << "Index[ ";
-    for (auto i : idx.ijk) {
-      os << i << " ";
-    }
-    os << "]";
-    return os;
-  }
-
-  // The P here is a phantom parameter to enable strong typing.
-  // It is not actually used anywhere directly.
-  template <typename T, typename Indexer, typename P>
-  struct Vector {
-    std::vector<T> vec;
-
-    Vector(Indexer dimension = default_dimension) {
-      vec.resize(dimension, 0.0);
-    }
-    Vector(std::initializer_list<T> list) : vec(list) {}
-
-    Vector(const Vector& other) : vec(other.vec) {}
-    Vector(const Vector&& other) : vec(std::move(other.vec)) {}
-
-    Vector& operator=(const Vector& other) {
-      vec = other.vec;
-      return *this;
-    }
-
-    inline T& operator[](Indexer index) { return vec[index]; }
-    inline T operator[](Indexer index) const { return vec[index]; }
-
-    inline auto size() { return static_cast<Indexer>(vec.size()); }
-
-    inline Vector& operator=(Vector&& other) {
-      vec = std::move(other.vec);
-      return *this;
-    }
-
-    inline T norm() const {
-      T nr = 0.0;
-      for (auto v : vec) {
-        nr += v * v;
+  template <typename T, typename I, typename Integrator = Euler,
+            typename Kernel, typename V, typename Observer = NullObserver>
+  inline I integrate_cell(V p, V v, const Kernel& kernel, const V& center,
+                          const FieldParms<T, I>& parms,
+                          Observer&& observe = Observer{},
+                          CellOutcome<T>* outcome = nullptr,
+                          I first_iteration = 0) {
+    const T delta_t = parms.delta_t;
+    const I iter_limit = parms.iter_limit;
+    const T escape_radius = parms.escape_radius;
+    const T switch_radius = kernel.far.switch_radius;
+    I iter = first_iteration;
+    T last_r = 0;  // before the latest step
+    CellOutcome<T> ignored;
+    CellOutcome<T>& out = outcome ? *outcome : ignored;
+    out = CellOutcome<T>{};
+    out.escape_time = iter_limit;
+    out.reached = iter_limit;
+
+    for (;;) {
+      T r = (p - center).norm();
+      if (r > escape_radius) {
+        // r grew past the radius during the step from last_r
+        if (iter > first_iteration && r > last_r)
+          out.escape_time = std::min<T>(
+              iter - 1 + (escape_radius - last_r) / (r - last_r), iter);
+        else
+          out.escape_time = iter;
+        break;
       }
-      return T(sqrt(nr));
-    }
-
-    inline T norm_squared() const {
-      T nr = 0.0;
-      for (auto v : vec) {
-        nr += v * v;
+      if (iter >= iter_limit) break;
+
+      if (kernel.has_capture) {
+        auto star = kernel.capture(p);
+        if (star != not_captured) {
+          out.captured_by = star;
+          return iter_limit;
+        }
       }
-      return nr;
-    }
-
-    inline Vector unit_vector() const { return *this / this->norm(); }
-
-    // Danger: behavior of vectors of unequal lengths is undefined.
-    inline T dot(const Vector& vo) const {
-      auto a = this->vec.cbegin();
-      auto b = vo.vec.cbegin();
-      T sum = 0;
-      for (; a != this->vec.cend(); ++a, ++b) sum += (*a) * (*b);
-      return sum;
-    }
 
-    // u x v, this being u, using Sarrus's Rule
-    // only valid for 3-vectors, no checks done.
-    // {u[2]v[3]-u[3]v[2], u[3]v[1]-u[1]v[3], u[1]v[2]-u[2]v[1]}
-    // indices adjusted for zero-based vectors in the code!!!!
-    inline Vector cross(const Vector& vo) const {
-      const auto& u = this->vec;
-      const auto& v = vo.vec;
-      return Vector{u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
-                    u[0] * v[1] - u[1] * v[0]};
-    }
-
-    inline Vector operator+(const Vector& other) const {
-      Vector result(vec.size());
-      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
-        result.vec[i] = vec[i] + other.vec[i];
-      }
-      return result;
-    }
-
-    inline Vector operator+=(const Vector& other) {
-      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
-        vec[i] += other.vec[i];
-      }
-      return *this;
-    }
-
-    inline Vector operator-(const Vector& other) const {
-      Vector result(vec.size());
-      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
-        result.vec[i] = vec[i] - other.vec[i];
-      }
-      return result;
-    }
-
-    inline Vector operator*(const floating_t scalar) const {
-      Vector result(vec.size());
-      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
-        result.vec[i] = vec[i] * scalar;
-      }
-      return result;
-    }
-
-    inline Vector operator/(const floating_t scalar) const {
-      Vector result(vec.size());
-      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
-        result.vec[i] = vec[i] / scalar;
+      if (r > switch_radius) {
+        auto leg = kepler_outbound_leg<T>(p, v, center, kernel.far.mu,
+                                          escape_radius);
+        if (leg.applicable) {
+          // the skipped steps count as iterations
+          T skipped = leg.escapes ? std::ceil(leg.time / delta_t)
+                                  : std::round(leg.time / delta_t);
+          if (iter + skipped >= iter_limit) {
+            out.reached = iter;
+            return iter_limit;
+          }
+          if (leg.escapes) {
+            out.escape_time = iter + leg.time / delta_t;
+            return iter + static_cast<I>(skipped);
+          }
+          iter += static_cast<I>(skipped);
+          p = leg.p;
+          v = leg.v;
+          observe(p, v);
+          continue;
+        }
       }
-      return result;
-    }
-
-    /**
-     * TODO: Note that this may not make sense for floats. We'll
-     * TODO: have to add an epsillon here eventually... this is
-     * TODO: mostly for testing.
-     */
-    inline bool operator==(const Vector& other) const {
-      return vec == other.vec;
-    }
-  };
-
-  // Specifically defined types for our model.
-  // TODO: Tighten up type safety here. Currently everything is defined as
-  // "MathParam".
-  using Coordinate = Vector<floating_t, indexer_t, struct MathParm>;
-  using Position = Vector<floating_t, indexer_t, struct MathParm>;
-  using Velocity = Vector<floating_t, indexer_t, struct MathParm>;
-  using Acceleration = Vector<floating_t, indexer_t, struct MathParm>;
-  using Vec =
-      Vector<floating_t, indexer_t, struct MathParm>;  // generalized vector
-
-  /**
-   * For some operations, it helps to have Position and Velocity
-   * combined.
-   */
-  struct PosVel {
-    Position p;
-    Velocity v;
-  };
-
-  /**
-   * A bounding box for the field
-   */
-  struct Bounds {
-    Coordinate nm;  // Negative-most coordinate
-    Coordinate pm;  // Positive-most coordinate
-    Bounds() = default;
-  };
 
-  template <typename T, typename I, typename P>
-  inline std::ostream& operator<<(std::ostream& os, Vector<T, I, P> const& c) {
-    os << "Vector[ ";
-    for (auto v : c.vec) {
-      os << v << " ";
+      last_r = r;
+      Integrator::step(p, v, delta_t, kernel);
+      observe(p, v);
+      ++iter;
     }
-    os << "]";
-    return os;
-  }
-
-  struct Star {
-    floating_t mass;
-    Position position;
-
-    Star(floating_t m, Position pos) : mass(m), position(pos) {}
-  };
-
-  inline std::ostream& operator<<(std::ostream& os, Star const& star) {
-    os << "Star[";
-    os << " mass:" << star.mass;
-    os << " position:" << star.position;
-    os << " ]";
-    return os;
-  }
-
-  /* Computes the acceleration of a single star on
-   * the fpm, the Free Point Mass.
-   */
-  template <typename T, typename I>
-  inline Acceleration compute_acceleration(const Star& star,
-                                           const Position& fpm,
-                                           const T gravitational_constant) {
-    auto r_vec = fpm - star.position;
-    auto r_squared = r_vec.norm_squared();
-    auto r = sqrt(r_squared);
-    auto unit_vec = r_vec / r;
-    auto force = (-gravitational_constant) * star.mass / r_squared;
-    return unit_vec * force;
-  }
-
-  /**
-   * Field Parameters for MGS. These determine the nature
-   * of the MGS fractal that is generated.
-   */
-  template <typename T, typename Interant>
-  struct FieldParms {
-    T gravitational_constant;
-    T delta_t;
-    Interant iter_limit;
-    T escape_radius;
-    FieldParms() = default;
-    FieldParms(T gc, T dt, Interant il, T er)
-        : gravitational_constant(gc),
-          delta_t(dt),
-          iter_limit(il),
-          escape_radius(er) {}
-  };
-
-  /**
-   */
-  template <typename T, typename I>
-  Position compute_center_of_star_mass(const std::vector<Star>& stars) {
-    T total_star_mass = 0.0;
-    Position center_accum;
-
-    for (auto star : stars) {
-      total_star_mass += star.mass;
-      center_accum += star.position * star.mass;
-    }
-    return center_accum / total_star_mass;
+    return iter;
   }
 
   /**
    * Iterates a single Free Point Mass from initial position and velocity.
    * This has been pulled out of Field to be callable independent of having
    * to set up the entire Field object when we are not computing the MGS.
+   *
+   * The observer, if any, is called with the position and velocity
+   * after every step. It is a template parameter so that observing
+   * costs only what the observer itself does; see observers.h for
+   * the stock ones. Pass it as an lvalue to read its state afterwards.
+   *
+   * The Integrator is a policy from integrators.h. Note that it is
+   * picked here at compile time; parms.integrator is only consulted
+   * by the Field renders, which dispatch on it. The force law is
+   * taken from parms.
    */
-  template <typename T, typename I>
-  inline I render_single_cell(
-      const Position& initial_p, const Velocity& initial_v,
-      const std::vector<Star>& stars, const Position& center_of_star_mass,
-      const FieldParms<T, I>& parms,
-      std::function<void(const Position&, const Velocity&)> cb = nullptr) {
-    auto [gravitational_constant, delta_t, iter_limit, escape_radius] = parms;
-    auto v = initial_v;
-    auto p = initial_p;
-    I iter = 0;
-
-    for (iter = 0;
-         iter < iter_limit && (p - center_of_star_mass).norm() <= escape_radius;
-         ++iter) {
-      Acceleration a;
-
-      // acceleration due to all the stars
-      for (auto star : stars) {
-        a += compute_acceleration<T, I>(star, p, gravitational_constant);
-      }
+  template <typename T, typename I, typename Integrator = Euler,
+            typename Observer = NullObserver>
+  inline I render_single_cell(const Position& initial_p,
+                              const Velocity& initial_v,
+                              const std::vector<Star>& stars,
+                              const Position& center_of_star_mass,
+                              const FieldParms<T, I>& parms,
+                              Observer&& observe = Observer{}) {
+    return with_force_law(
+        parms.force_law, parms.softening, parms.force_exponent,
+        [&](const auto& law) {
+          DirectSumKernel<T, I, std::decay_t<decltype(law)>> kernel(
+              stars, center_of_star_mass, parms.gravitational_constant,
+              parms.kepler_tolerance, law, parms.capture_radius);
+          return integrate_cell<T, I, Integrator>(
+              initial_p, initial_v, kernel, center_of_star_mass, parms,
+              std::forward<Observer>(observe));
+        });
+  }
 
-      // Eulerian integration
-      v += a * delta_t;
-      p += v * delta_t;
-      if (cb) cb(p, v);
-    }
-    return iter;
+  /**
+   * As above, but with the stars' pull taken from a Barnes-Hut tree
+   * built over them (see octree.h) with parms.capture_radius.
+   */
+  template <typename T, typename I, typename Integrator = Euler,
+            typename Observer = NullObserver>
+  inline I render_single_cell(const Position& initial_p,
+                              const Velocity& initial_v,
+                              const StarTree<T>& tree,
+                              const std::vector<Star>& stars,
+                              const Position& center_of_star_mass,
+                              const FieldParms<T, I>& parms,
+                              Observer&& observe = Observer{}) {
+    return with_force_law(
+        parms.force_law, parms.softening, parms.force_exponent,
+        [&](const auto& law) {
+          TreeKernel<T, std::decay_t<decltype(law)>> kernel(
+              tree, stars, center_of_star_mass, parms.gravitational_constant,
+              parms.kepler_tolerance, law);
+          return integrate_cell<T, I, Integrator>(
+              Vec3<T>(initial_p), Vec3<T>(initial_v), kernel,
+              Vec3<T>(center_of_star_mass), parms,
+              std::forward<Observer>(observe));
+        });
   }
 
   /**
@@ -350,6 +214,19 @@ namespace mgs {
     std::vector<Iterant> grid;
     std::vector<Star> stars;
     Position center_of_star_mass;
+    // built at render start when parms.opening_angle calls for one
+    std::shared_ptr<const StarTree<T>> star_tree;
+    // built at render start when parms.accel_grid_size calls for one;
+    // see its error() for how well it approximates the stars
+    std::shared_ptr<const AccelGrid<T>> accel_grid;
+
+    // The per-cell outputs the renders are to fill besides grid, such
+    // as captured_by for a basin of attraction map. See channels.h.
+    ChannelSet channels;
+    // Where the orbits stopped by the iteration limit stopped, if
+    // kept, so that raising the limit only continues those. See
+    // resume.h.
+    ResumeTable<T> resume;
     Indexer cube_size;
     Indexer dimension;
 
@@ -429,9 +306,191 @@ namespace mgs {
       return c;
     }
 
-    void render_with_callback(std::function<void(Index, Position)> cb);
+    using cell_callback_t = std::function<void(Index, Position)>;
+
+    /**
+     * Called once per completed brick, from the worker thread that
+     * rendered it, with the iteration counts of the whole brick laid
+     * out densely (first axis fastest) as per brick.origin and
+     * brick.extent. The span is only valid for the duration of the
+     * call.
+     */
+    using brick_callback_t =
+        std::function<void(const Brick& brick, Span<const Iterant> iters)>;
+
+    /**
+     * Render the whole field, blocking until done (or cancelled
+     * through options.token), the calling thread coordinating. The
+     * callback, if given, is called for each cell once its iteration
+     * count is in the grid, from whichever worker thread computed it.
+     */
+    void render_with_callback(cell_callback_t cb,
+                              const RenderOptions& options = {});
+
+    /**
+     * Render the field in the background. The returned job may be
+     * cancelled, polled for progress, or waited upon. This Field
+     * must not be moved or destroyed while the job is running.
+     */
+    RenderJob render_async(cell_callback_t cb = nullptr,
+                           const RenderOptions& options = {});
+
+    /**
+     * As render_with_callback() and render_async(), but delivering
+     * the results a brick at a time rather than per cell.
+     */
+    void render_with_brick_callback(brick_callback_t cb,
+                                    const RenderOptions& options = {});
+    RenderJob render_bricks_async(brick_callback_t cb,
+                                  const RenderOptions& options = {});
+
+    /**
+     * Render the field coarse to fine in the background, telling
+     * each subscriber as every level completes. See progressive.h.
+     */
+    RenderJob render_progressive(
+        const std::vector<LevelSubscriber>& subscribers,
+        cell_callback_t cb = nullptr, const RenderOptions& options = {},
+        Indexer coarsest_stride = default_coarsest_stride);
+
+    /**
+     * Render as much of the field as the budget allows, the cells
+     * telling the most first, carrying on from any earlier call. See
+     * anytime.h.
+     */
+    AnytimeResult render_anytime(const AnytimeOptions& anytime,
+                                 const RenderOptions& options = {});
+
+    /**
+     * For rendering bricks one at a time as they are handed out, as
+     * a distributed worker does (see distributed.h): prepare_bricks()
+     * once for the layout, then render_single_brick() for each brick
+     * of it, on the calling thread.
+     */
+    void prepare_bricks(const BrickLayout& layout, unsigned threads = 1);
+    std::uint64_t render_single_brick(const Brick& brick,
+                                      const brick_callback_t& cb,
+                                      const CancelToken& token = {});
+
+    /**
+     * The value of the given cell as seen at a level of the given
+     * stride, i.e. that of the nearest computed cell at or below it.
+     * Handy for showing a coarse level before the finer ones land.
+     */
+    Iterant at_stride(const idx_vector_t& ijk, Indexer stride) const {
+      std::size_t off = 0;
+      std::size_t r = 1;
+      for (Indexer d = 0; d < dimension; ++d) {
+        off += (ijk[d] / stride * stride) * r;
+        r *= cube_size;
+      }
+      return grid[off];
+    }
+
+    /**
+     * As at_stride(), at the finest stride (of the levels down from
+     * the coarsest given) at which it has been computed; untouched if
+     * at none. A field part way through an anytime or progressive
+     * render reads as the best it has so far.
+     */
+    Iterant at_best(const idx_vector_t& ijk,
+                    Indexer coarsest_stride = default_coarsest_stride) const {
+      auto strides = level_strides(coarsest_stride);
+      for (auto s = strides.rbegin(); s != strides.rend(); ++s) {
+        auto value = at_stride(ijk, *s);
+        if (value != Iterant(untouched)) return value;
+      }
+      return Iterant(untouched);
+    }
+
+    /**
+     * The starting position of the FPM for the given cell. Axes
+     * beyond the field's dimension sit at the middle of the bounds.
+     */
+    Position cell_position(const idx_vector_t& ijk) const {
+      Position c;
+      for (Indexer i = 0; i < c.size(); ++i) {
+        c[i] = (i < dimension && cube_size > 1)
+                   ? box.nm[i] + (box.pm[i] - box.nm[i]) * ijk[i] /
+                                     (cube_size - 1)
+                   : (box.nm[i] + box.pm[i]) / 2.0;
+      }
+      return c;
+    }
+
+    std::size_t offset(const idx_vector_t& ijk) const {
+      std::size_t off = 0;
+      std::size_t r = 1;
+      for (Indexer d = 0; d < dimension; ++d) {
+        off += ijk[d] * r;
+        r *= cube_size;
+      }
+      return off;
+    }
+
+    /**
+     * The signature (see signature.h) of everything a render's
+     * results depend on: the bounds and resolution, the stars, the
+     * parameters, with or without the iteration limit, and the
+     * channels asked for.
+     */
+    std::uint64_t signature(bool with_iter_limit = true) const;
+
+    /**
+     * The key of the brick in a BrickCache: the signature of the
+     * physics, the kernel version, and where the brick's cells lie,
+     * as the spacing of the lattice, its phase, and the brick's
+     * place and extent on it. Positions are taken as equal within
+     * a part in a million of the spacing, up to a million cells
+     * along the lattice. The bounds only go in
+     * when an acceleration grid, which spans them, is in use.
+     */
+    std::uint64_t brick_key(const Brick& brick) const;
+
+    /**
+     * The estimated cost of each brick of the layout, in steps, from
+     * a pre-pass over a few cells of each (2 per axis, a quarter of
+     * the way in) with the iteration limit cut to estimate_iter_limit.
+     * A cell reaching that is taken to go on to the full limit. Used
+     * to schedule the bricks longest first (see scheduler.h); needs
+     * prepare_render() to have been done, as it is by the renders.
+     * Runs on the pool's threads, if given.
+     */
+    std::vector<double> estimate_brick_costs(const BrickLayout& layout,
+                                             unsigned threads,
+                                             const CancelToken& token = {},
+                                             ThreadPool* pool = nullptr);
 
    private:
+    // the limit of the render being resumed, 0 if not resuming
+    Iterant m_resume_from = 0;
+    // for anytime renders, which leave cells already done alone
+    bool m_fill_only = false;
+    std::uint64_t m_anytime_signature = 0;
+    // for full renders asked to use one
+    std::shared_ptr<BrickCache> m_cache;
+
+    // all but the bounds and resolution
+    void add_physics(Signature& sig, bool with_iter_limit) const;
+    void prepare_render(std::size_t bricks, bool anytime = false);
+    double brick_priority(const Brick& brick, Indexer coarser_stride,
+                          const std::optional<Bounds>& roi) const;
+    void build_accel_grid(unsigned threads, const CancelToken& token,
+                          ThreadPool* pool = nullptr);
+    std::vector<double> schedule_costs(BrickSchedule schedule,
+                                       const BrickLayout& layout,
+                                       unsigned threads,
+                                       RenderJobState& state,
+                                       ThreadPool* pool);
+    // in the background, or on the calling thread if in_place
+    RenderJob launch_render(cell_callback_t cb, brick_callback_t bcb,
+                            const RenderOptions& options,
+                            bool in_place = false);
+
+    std::uint64_t render_brick(const Brick& brick, const CancelToken& token,
+                               const cell_callback_t& cb,
+                               const brick_callback_t& bcb,
+                               Indexer stride = 1, Indexer skip = 0);
   };
 
   /**
@@ -459,6 +518,18 @@ namespace mgs {
     os << " gravitational_constant:" << f.parms.gravitational_constant;
     os << " escappe_radius:" << f.parms.escape_radius;
     os << " delta_t:" << f.parms.delta_t;
+    os << " integrator:" << integrator_name(f.parms.integrator);
+    if (f.parms.adaptive) os << " adaptive_eta:" << f.parms.adaptive_eta;
+    os << " force_law:" << force_law_name(f.parms.force_law);
+    if (f.parms.softening > 0) os << " softening:" << f.parms.softening;
+    if (f.parms.force_law == ForceLawKind::power_law)
+      os << " force_exponent:" << f.parms.force_exponent;
+    if (f.parms.opening_angle > 0)
+      os << " opening_angle:" << f.parms.opening_angle;
+    if (f.parms.accel_grid_size > 0)
+      os << " accel_grid_size:" << f.parms.accel_grid_size;
+    if (f.parms.capture_radius > 0)
+      os << " capture_radius:" << f.parms.capture_radius;
 
     os << "Stars[ ";
     for (auto star : f.stars) {
@@ -0,0 +1,343 @@
+#include <daemon.h>
+
+#include <shared_field.h>
+#include <wire.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+namespace mgs {
+  using namespace wire;
+
+  namespace {
+    const std::uint32_t result_file_magic = 0x5253474d;  // "MGSR"
+
+    RenderStatus completed_unless(const CancelToken& token) {
+      return token.cancelled() ? RenderStatus::cancelled
+                               : RenderStatus::completed;
+    }
+  }  // namespace
+
+  struct RenderDaemon::Connection {
+    int fd = -1;
+    std::vector<std::uint8_t> inbox;  // the start of a frame, if any
+    std::atomic<bool> gone{false};
+    std::mutex sending;  // a reply at a time
+
+    ~Connection() {
+      if (fd >= 0) ::close(fd);
+    }
+  };
+
+  struct RenderDaemon::Job {
+    std::shared_ptr<Connection> from;
+    std::int32_t priority = 0;
+    std::uint64_t arrival = 0;
+    std::uint64_t sequence = 0;
+    std::string output_path;
+    std::string shared_name;
+    StarField field;
+  };
+
+  RenderDaemon::RenderDaemon(const std::string& endpoint,
+                             const DaemonOptions& options)
+      : m_options(options) {
+    m_listener = listen_on(endpoint, m_endpoint, m_unix_path);
+    if (m_listener < 0) return;
+    if (::pipe2(m_wake, O_CLOEXEC) != 0) {
+      ::close(m_listener);
+      m_listener = -1;
+      return;
+    }
+    m_pool = std::make_shared<ThreadPool>(options.threads);
+    m_acceptor = std::thread([this] { accept_jobs(); });
+    m_runner = std::thread([this] { run_jobs(); });
+  }
+
+  RenderDaemon::~RenderDaemon() {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_stop = true;
+      if (m_running) m_running_token.cancel();
+    }
+    m_work.notify_all();
+    if (m_wake[1] >= 0) {
+      char stop = 0;
+      while (::write(m_wake[1], &stop, 1) < 0 && errno == EINTR) {
+      }
+    }
+    if (m_acceptor.joinable()) m_acceptor.join();
+    if (m_runner.joinable()) m_runner.join();
+    m_queue.clear();
+    for (int fd : m_wake)
+      if (fd >= 0) ::close(fd);
+    if (m_listener >= 0) ::close(m_listener);
+    if (!m_unix_path.empty()) ::unlink(m_unix_path.c_str());
+  }
+
+  DaemonStats RenderDaemon::stats() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto stats = m_stats;
+    stats.queued = m_queue.size();
+    return stats;
+  }
+
+  void RenderDaemon::pause() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_paused = true;
+  }
+
+  void RenderDaemon::resume() {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_paused = false;
+    }
+    m_work.notify_all();
+  }
+
+  /**
+   * One thread takes in clients and their requests, around poll(),
+   * and cancels the jobs of those that go away.
+   */
+  void RenderDaemon::accept_jobs() {
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::vector<pollfd> polled;
+    auto hang_up = [&](Connection& c) {
+      c.gone = true;
+      std::lock_guard<std::mutex> guard(m_lock);
+      if (m_running == &c) m_running_token.cancel();
+    };
+
+    for (;;) {
+      polled.assign({pollfd{m_wake[0], POLLIN, 0},
+                     pollfd{m_listener, POLLIN, 0}});
+      for (auto& c : connections) polled.push_back({c->fd, POLLIN, 0});
+      if (::poll(polled.data(), polled.size(), -1) < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      if (polled[0].revents) break;
+
+      for (std::size_t i = 2; i < polled.size(); ++i) {
+        if (!polled[i].revents) continue;
+        auto& c = connections[i - 2];
+        std::uint8_t chunk[1 << 16];
+        auto n = ::recv(c->fd, chunk, sizeof chunk, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) {
+          hang_up(*c);
+          continue;
+        }
+        c->inbox.insert(c->inbox.end(), chunk, chunk + n);
+        take_frames(c->inbox, [&](const FrameHeader& header,
+                                  const std::uint8_t* body, std::size_t size) {
+          if (header.kind == MessageKind::request) enqueue(c, body, size);
+        });
+      }
+      connections.erase(
+          std::remove_if(connections.begin(), connections.end(),
+                         [](const auto& c) { return c->gone.load(); }),
+          connections.end());
+
+      if (polled[1].revents) {
+        for (int fd; (fd = accept_from(m_listener)) >= 0;) {
+          auto c = std::make_shared<Connection>();
+          c->fd = fd;
+          connections.push_back(std::move(c));
+        }
+      }
+    }
+    for (auto& c : connections) hang_up(*c);
+  }
+
+  void RenderDaemon::enqueue(const std::shared_ptr<Connection>& from,
+                             const std::uint8_t* bytes, std::size_t size) {
+    auto job = std::make_unique<Job>();
+    job->from = from;
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      job->arrival = ++m_arrivals;
+      if (!m_spare_grids.empty()) {
+        job->field.grid = std::move(m_spare_grids.back());
+        m_spare_grids.pop_back();
+      }
+    }
+    const auto capacity = job->field.grid.capacity();
+
+    Reader r(bytes, size);
+    r.io(job->priority);
+    r.io(job->output_path);
+    r.io(job->shared_name);
+    if (!read_field(r, job->field)) {
+      finish(*job, RenderStatus::cancelled, 0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      if (job->field.grid.capacity() > capacity) ++m_stats.grids_allocated;
+      m_queue.push_back(std::move(job));
+      std::push_heap(m_queue.begin(), m_queue.end(), runs_later);
+    }
+    m_work.notify_all();
+  }
+
+  void RenderDaemon::run_jobs() {
+    using clock = std::chrono::steady_clock;
+    for (;;) {
+      std::unique_ptr<Job> job;
+      RenderOptions options;
+      {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_work.wait(lock, [&] {
+          return m_stop || (!m_paused && !m_queue.empty());
+        });
+        if (m_stop) return;
+        std::pop_heap(m_queue.begin(), m_queue.end(), runs_later);
+        job = std::move(m_queue.back());
+        m_queue.pop_back();
+        job->sequence = ++m_sequence;
+        m_running = job->from.get();
+        m_running_token = options.token;
+      }
+      if (job->from->gone) options.token.cancel();
+
+      options.threads = m_pool->size();
+      options.brick_size = m_options.brick_size;
+      options.schedule = m_options.schedule;
+      options.pool = m_pool;
+      const auto started = clock::now();
+      // rendered on this thread and the pool's, starting none
+      auto status = RenderStatus::cancelled;
+      if (options.token.cancelled()) {
+        // gone before it started
+      } else if (job->shared_name.empty()) {
+        job->field.render_with_callback(nullptr, options);
+        status = completed_unless(options.token);
+      } else {
+        // the client maps it, and removes it when done
+        SharedFieldWriter shared(job->shared_name, job->field, false);
+        if (shared.valid()) {
+          job->field.render_with_brick_callback(shared.publisher(), options);
+          status = completed_unless(options.token);
+        }
+        if (status == RenderStatus::completed) shared.finish();
+        // nobody left to map it, or nothing worth mapping
+        if (status != RenderStatus::completed || job->from->gone)
+          remove_shared_field(job->shared_name);
+      }
+      const std::chrono::duration<double> seconds = clock::now() - started;
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_running = nullptr;
+      }
+      finish(*job, status, seconds.count());
+    }
+  }
+
+  /**
+   * Answers the job's client, if still there, and keeps its grid
+   * for a job to come.
+   */
+  void RenderDaemon::finish(Job& job, RenderStatus status, double seconds) {
+    const bool in_reply =
+        job.output_path.empty() && job.shared_name.empty();
+    if (status == RenderStatus::completed && !job.output_path.empty()) {
+      Writer file;
+      file.io(result_file_magic);
+      write_results(file, job.field);
+      std::ofstream out(job.output_path, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(file.bytes().data()),
+                file.bytes().size());
+      if (!out) status = RenderStatus::cancelled;
+    }
+
+    Writer w;
+    w.io(status);
+    w.io(job.sequence);
+    w.io(seconds);
+    const bool with_results = status == RenderStatus::completed && in_reply;
+    w.io(static_cast<std::uint8_t>(with_results));
+    if (with_results) write_results(w, job.field);
+
+    // done with before the client hears, so it sees it done
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      ++m_stats.jobs;
+      if (status == RenderStatus::cancelled) ++m_stats.cancelled;
+      if (m_spare_grids.size() < m_options.spare_grids &&
+          job.field.grid.capacity() > 0)
+        m_spare_grids.push_back(std::move(job.field.grid));
+    }
+    if (!job.from->gone) {
+      std::lock_guard<std::mutex> guard(job.from->sending);
+      send_all(job.from->fd, w.frame(MessageKind::reply));
+    }
+  }
+
+  bool RenderDaemon::runs_later(const std::unique_ptr<Job>& a,
+                                const std::unique_ptr<Job>& b) {
+    if (a->priority != b->priority) return a->priority < b->priority;
+    return a->arrival > b->arrival;
+  }
+
+  DaemonClient::DaemonClient(const std::string& endpoint)
+      : m_fd(connect_to(endpoint)) {}
+
+  DaemonClient::~DaemonClient() {
+    if (m_fd >= 0) ::close(m_fd);
+  }
+
+  bool DaemonClient::render(StarField& field, const DaemonJob& job,
+                            DaemonReply* reply) {
+    return submit(field, job) && receive(field, reply);
+  }
+
+  bool DaemonClient::submit(const StarField& field, const DaemonJob& job) {
+    if (m_fd < 0) return false;
+    Writer w;
+    w.io(job.priority);
+    w.io(job.output_path);
+    w.io(job.shared_name);
+    write_field(w, field);
+    return send_all(m_fd, w.frame(MessageKind::request));
+  }
+
+  bool DaemonClient::receive(StarField& field, DaemonReply* reply) {
+    if (m_fd < 0) return false;
+    FrameHeader header;
+    std::vector<std::uint8_t> body;
+    if (!receive_frame(m_fd, header, body) ||
+        header.kind != MessageKind::reply)
+      return false;
+    Reader r(body.data(), body.size());
+    DaemonReply got;
+    std::uint8_t with_results = 0;
+    r.io(got.status);
+    r.io(got.sequence);
+    r.io(got.seconds);
+    r.io(with_results);
+    if (!r.good() || (with_results && !read_results(r, field))) return false;
+    if (reply) *reply = got;
+    return true;
+  }
+
+  bool read_result_file(const std::string& path, StarField& field) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+    Reader r(bytes.data(), bytes.size());
+    std::uint32_t magic = 0;
+    r.io(magic);
+    return r.good() && magic == result_file_magic && read_results(r, field);
+  }
+}  // namespace mgs
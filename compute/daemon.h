@@ -0,0 +1,154 @@
+#pragma once
+
+/**
+ * A render daemon: a long-running process that renders fields for
+ * others, so that a small render costs what the render itself does
+ * and not the starting of threads and allocating of grids first.
+ *
+ * A RenderDaemon listens on a Unix socket ("unix:/path/to/socket",
+ * see wire.h) for clients (DaemonClient) sending it fields to render:
+ * their bounds, stars, parameters and channels, with a priority. The
+ * jobs queue highest priority first, first come first within one,
+ * and are rendered one at a time on a ThreadPool kept for the life of
+ * the daemon, into grids kept from the jobs before. A client that
+ * goes away has its jobs cancelled, queued or running.
+ *
+ * The results, the grid and channels, go back in the reply, or to a
+ * file named in the request, for read_result_file(). Or the grid
+ * alone goes to a shared memory segment named in the request, brick
+ * by brick as rendered, for the client to map (see shared_field.h).
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  struct DaemonOptions {
+    unsigned threads = 0;  // of the pool; 0 means one per hardware thread
+    std::int32_t brick_size = default_brick_size;
+    BrickSchedule schedule = BrickSchedule::in_order;
+    // grids kept from finished jobs for the next ones
+    std::size_t spare_grids = 4;
+  };
+
+  struct DaemonStats {
+    std::uint64_t jobs = 0;       // rendered, in full or not
+    std::uint64_t cancelled = 0;  // of them, or dropped before starting
+    // grids the jobs could not take from those kept
+    std::uint64_t grids_allocated = 0;
+    std::uint64_t queued = 0;  // now
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, const DaemonStats& s) {
+    os << "DaemonStats[ jobs:" << s.jobs << " cancelled:" << s.cancelled
+       << " grids_allocated:" << s.grids_allocated << " queued:" << s.queued
+       << " ]";
+    return os;
+  }
+
+  struct DaemonJob {
+    std::int32_t priority = 0;  // higher first
+    // where to write the results; empty to have them in the reply
+    std::string output_path;
+    // or a shared memory segment to publish the grid to as it renders
+    std::string shared_name;
+  };
+
+  struct DaemonReply {
+    RenderStatus status = RenderStatus::cancelled;
+    std::uint64_t sequence = 0;  // the job's place in the daemon's order
+    double seconds = 0;          // rendering it
+  };
+
+  class RenderDaemon {
+   public:
+    // starts listening on the endpoint (see listening()) and serving
+    explicit RenderDaemon(const std::string& endpoint,
+                          const DaemonOptions& options = {});
+    ~RenderDaemon();  // cancels what is left
+
+    RenderDaemon(const RenderDaemon&) = delete;
+    RenderDaemon& operator=(const RenderDaemon&) = delete;
+
+    bool listening() const { return m_listener >= 0; }
+    const std::string& endpoint() const { return m_endpoint; }
+    DaemonStats stats() const;
+
+    // jobs queue up but none starts until resumed
+    void pause();
+    void resume();
+
+   private:
+    struct Connection;
+    struct Job;
+
+    DaemonOptions m_options;
+    std::string m_endpoint;
+    std::string m_unix_path;  // to remove
+    int m_listener = -1;
+    int m_wake[2] = {-1, -1};  // to stop the acceptor waiting
+    std::shared_ptr<ThreadPool> m_pool;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_work;
+    std::vector<std::unique_ptr<Job>> m_queue;  // a heap
+    std::vector<std::vector<iterant_t>> m_spare_grids;
+    std::uint64_t m_arrivals = 0;
+    std::uint64_t m_sequence = 0;
+    const Connection* m_running = nullptr;  // whose job, if any
+    CancelToken m_running_token;
+    DaemonStats m_stats;
+    bool m_paused = false;
+    bool m_stop = false;
+
+    std::thread m_acceptor;
+    std::thread m_runner;
+
+    void accept_jobs();
+    void run_jobs();
+    void enqueue(const std::shared_ptr<Connection>& from,
+                 const std::uint8_t* bytes, std::size_t size);
+    void finish(Job& job, RenderStatus status, double seconds);
+    // for a heap with the next job to run on top
+    static bool runs_later(const std::unique_ptr<Job>& a,
+                           const std::unique_ptr<Job>& b);
+  };
+
+  class DaemonClient {
+   public:
+    explicit DaemonClient(const std::string& endpoint);
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    bool connected() const { return m_fd >= 0; }
+
+    /**
+     * Renders the field on the daemon, blocking until done: its grid
+     * and channels come back into it, unless sent to the job's
+     * output file or shared memory segment. False if the daemon
+     * could not be reached.
+     */
+    bool render(StarField& field, const DaemonJob& job = {},
+                DaemonReply* reply = nullptr);
+
+    // render() in two halves, to have several jobs queued at once
+    bool submit(const StarField& field, const DaemonJob& job = {});
+    bool receive(StarField& field, DaemonReply* reply = nullptr);
+
+   private:
+    int m_fd = -1;
+  };
+
+  // reads a job's output file back into the field's grid and channels
+  bool read_result_file(const std::string& path, StarField& field);
+}  // namespace mgs
@@ -0,0 +1,329 @@
+#include <distributed.h>
+
+#include <wire.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+
+namespace mgs {
+  using namespace wire;
+
+  namespace {
+    std::vector<std::uint8_t> job_message(std::uint64_t job,
+                                          const StarField& field,
+                                          std::int32_t brick_size) {
+      Writer w;
+      w.io(job);
+      w.io(brick_size);
+      write_field(w, field);
+      return w.frame(MessageKind::job);
+    }
+
+    std::vector<std::uint8_t> brick_message(std::uint64_t job,
+                                            brick_id_t brick) {
+      Writer w;
+      w.io(job);
+      w.io(static_cast<std::uint64_t>(brick));
+      return w.frame(MessageKind::brick);
+    }
+
+    void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+      while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+      }
+      out.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    bool get_varint(const std::uint8_t*& at, const std::uint8_t* end,
+                    std::uint64_t& v) {
+      v = 0;
+      for (int shift = 0; at < end && shift < 64; shift += 7) {
+        auto byte = *at++;
+        v |= std::uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+      }
+      return false;
+    }
+  }  // namespace
+
+  std::vector<std::uint8_t> encode_runs(const iterant_t* values,
+                                        std::size_t count) {
+    std::vector<std::uint8_t> out;
+    std::int64_t previous = 0;
+    for (std::size_t i = 0; i < count;) {
+      std::size_t run = 1;
+      while (i + run < count && values[i + run] == values[i]) ++run;
+      const std::int64_t delta = std::int64_t(values[i]) - previous;
+      put_varint(out, (std::uint64_t(delta) << 1) ^ std::uint64_t(delta >> 63));
+      put_varint(out, run - 1);
+      previous = values[i];
+      i += run;
+    }
+    return out;
+  }
+
+  bool decode_runs(const std::uint8_t* bytes, std::size_t size,
+                   iterant_t* values, std::size_t count) {
+    const std::uint8_t* at = bytes;
+    const std::uint8_t* end = bytes + size;
+    std::int64_t previous = 0;
+    std::size_t filled = 0;
+    while (at < end) {
+      std::uint64_t zigzag, run;
+      if (!get_varint(at, end, zigzag) || !get_varint(at, end, run) ||
+          run >= count - filled)
+        return false;
+      previous += std::int64_t(zigzag >> 1) ^ -std::int64_t(zigzag & 1);
+      std::fill_n(values + filled, run + 1, static_cast<iterant_t>(previous));
+      filled += run + 1;
+    }
+    return filled == count;
+  }
+
+  struct Coordinator::Connection {
+    int fd = -1;
+    std::vector<std::uint8_t> inbox;  // the start of a frame, if any
+    std::vector<brick_id_t> out;      // with it, of the current job
+    bool joined = false;              // sent the current job
+
+    ~Connection() {
+      if (fd >= 0) ::close(fd);
+    }
+  };
+
+  Coordinator::Coordinator(const std::string& endpoint) {
+    m_listener = listen_on(endpoint, m_endpoint, m_unix_path);
+  }
+
+  Coordinator::~Coordinator() {
+    m_connections.clear();
+    if (m_listener >= 0) ::close(m_listener);
+    if (!m_unix_path.empty()) ::unlink(m_unix_path.c_str());
+  }
+
+  std::size_t Coordinator::workers() const { return m_connections.size(); }
+
+  void Coordinator::accept_waiting() {
+    for (;;) {
+      int fd = accept_from(m_listener);
+      if (fd < 0) return;
+      auto connection = std::make_unique<Connection>();
+      connection->fd = fd;
+      m_connections.push_back(std::move(connection));
+    }
+  }
+
+  /**
+   * One thread does it all, around poll(): taking in workers,
+   * handing out bricks, and collecting what comes back.
+   */
+  RenderStatus Coordinator::render(StarField& field,
+                                   const DistributedOptions& options,
+                                   const CancelToken& token) {
+    using clock = std::chrono::steady_clock;
+    m_report = {};
+    if (!listening()) return RenderStatus::cancelled;
+
+    const std::uint64_t job = ++m_job;
+    BrickLayout layout(field.cube_size, field.dimension, options.brick_size);
+    const auto job_bytes = job_message(job, field, layout.brick_size());
+    field.grid.resize(layout.cells(), untouched);
+
+    const std::size_t n_bricks = layout.size();
+    std::deque<brick_id_t> queue;
+    for (brick_id_t b = 0; b < n_bricks; ++b) queue.push_back(b);
+    std::vector<unsigned> copies(n_bricks, 0);  // out with workers
+    std::vector<bool> done(n_bricks, false);
+    std::size_t remaining = n_bricks;
+    std::vector<iterant_t> counts;
+
+    for (auto& c : m_connections) {
+      c->out.clear();
+      c->joined = false;
+    }
+    auto drop = [&](Connection& c) {
+      for (auto b : c.out) {
+        --copies[b];
+        if (!done[b]) {
+          queue.push_front(b);
+          ++m_report.reissued;
+        }
+      }
+      c.out.clear();
+      if (c.joined) ++m_report.lost;
+      ::close(c.fd);
+      c.fd = -1;
+    };
+    // the next brick for c: one not yet handed out, or else the one
+    // still out with the fewest workers, if c has not got it
+    auto next_brick = [&](Connection& c, brick_id_t& b) {
+      while (!queue.empty()) {
+        b = queue.front();
+        queue.pop_front();
+        if (!done[b]) return true;
+      }
+      bool found = false;
+      for (brick_id_t x = 0; x < n_bricks; ++x) {
+        if (done[x] || (found && copies[x] >= copies[b]) ||
+            std::find(c.out.begin(), c.out.end(), x) != c.out.end())
+          continue;
+        b = x;
+        found = true;
+      }
+      if (found) ++m_report.reissued;
+      return found;
+    };
+    auto take_result = [&](Connection& c, const std::uint8_t* bytes,
+                           std::size_t size) {
+      Reader r(bytes, size);
+      std::uint64_t result_job = 0, id = 0, count = 0;
+      r.io(result_job);
+      r.io(id);
+      r.io(count);
+      if (!r.good() || result_job != job || id >= n_bricks) return;
+      auto at = std::find(c.out.begin(), c.out.end(), id);
+      if (at == c.out.end()) return;
+      c.out.erase(at);
+      --copies[id];
+      const Brick brick = layout[id];
+      if (done[id] || count != brick.cells()) return;
+      counts.resize(count);
+      if (!decode_runs(r.rest(), r.left(), counts.data(), count)) return;
+      const std::size_t row_length = brick.extent[0];
+      for_each_row(brick, [&](const idx_vector_t& row, std::size_t local) {
+        std::copy_n(counts.begin() + local, row_length,
+                    field.grid.begin() + field.offset(row));
+      });
+      done[id] = true;
+      --remaining;
+      ++m_report.bricks;
+      m_report.cells_bytes += count * sizeof(iterant_t);
+      m_report.received_bytes += sizeof(FrameHeader) + size;
+    };
+
+    auto last_worker = clock::now();
+    RenderStatus status = RenderStatus::completed;
+    std::vector<pollfd> polled;
+    while (remaining > 0) {
+      if (token.cancelled()) {
+        status = RenderStatus::cancelled;
+        break;
+      }
+      accept_waiting();
+
+      for (auto& c : m_connections) {
+        if (c->fd < 0) continue;
+        if (!c->joined) {
+          c->joined = true;
+          ++m_report.workers;
+          if (!send_all(c->fd, job_bytes)) {
+            drop(*c);
+            continue;
+          }
+        }
+        brick_id_t b;
+        while (c->out.size() < std::max(1u, options.per_worker) &&
+               next_brick(*c, b)) {
+          c->out.push_back(b);
+          ++copies[b];
+          if (!send_all(c->fd, brick_message(job, b))) {
+            drop(*c);
+            break;
+          }
+        }
+      }
+      m_connections.erase(
+          std::remove_if(m_connections.begin(), m_connections.end(),
+                         [](const auto& c) { return c->fd < 0; }),
+          m_connections.end());
+
+      if (!m_connections.empty()) {
+        last_worker = clock::now();
+      } else if (clock::now() - last_worker > options.give_up_after) {
+        status = RenderStatus::cancelled;
+        break;
+      }
+
+      polled.assign(1, pollfd{m_listener, POLLIN, 0});
+      for (auto& c : m_connections) polled.push_back({c->fd, POLLIN, 0});
+      if (::poll(polled.data(), polled.size(), 50) <= 0) continue;
+
+      for (std::size_t i = 1; i < polled.size(); ++i) {
+        if (!polled[i].revents) continue;
+        auto& c = *m_connections[i - 1];
+        std::uint8_t chunk[1 << 16];
+        auto n = ::recv(c.fd, chunk, sizeof chunk, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) {
+          drop(c);
+          continue;
+        }
+        c.inbox.insert(c.inbox.end(), chunk, chunk + n);
+        take_frames(c.inbox, [&](const FrameHeader& header,
+                                 const std::uint8_t* body, std::size_t size) {
+          if (header.kind == MessageKind::result) take_result(c, body, size);
+        });
+      }
+    }
+
+    m_connections.erase(
+        std::remove_if(m_connections.begin(), m_connections.end(),
+                       [](const auto& c) { return c->fd < 0; }),
+        m_connections.end());
+    return status;
+  }
+
+  bool run_worker(const std::string& endpoint, std::uint64_t* bricks) {
+    int fd = connect_to(endpoint);
+    if (fd < 0) return false;
+
+    StarField field;
+    BrickLayout layout;
+    std::uint64_t job = 0;
+    bool ready = false;
+    std::vector<std::uint8_t> body;
+    FrameHeader header;
+    while (receive_frame(fd, header, body)) {
+      Reader r(body.data(), body.size());
+
+      if (header.kind == MessageKind::job) {
+        std::int32_t brick_size = 0;
+        r.io(job);
+        r.io(brick_size);
+        ready = read_field(r, field);
+        if (!ready) continue;
+        // only the counts go back
+        field.channels = ChannelSet();
+        layout = BrickLayout(field.cube_size, field.dimension, brick_size);
+        field.prepare_bricks(layout);
+      } else if (header.kind == MessageKind::brick && ready) {
+        std::uint64_t brick_job = 0, id = 0;
+        r.io(brick_job);
+        r.io(id);
+        if (!r.good() || brick_job != job || id >= layout.size()) continue;
+        bool sent = true;
+        field.render_single_brick(
+            layout[id], [&](const Brick&, Span<const iterant_t> counts) {
+              Writer w;
+              w.io(job);
+              w.io(id);
+              w.io(static_cast<std::uint64_t>(counts.size()));
+              auto runs = encode_runs(counts.data(), counts.size());
+              w.io(runs.data(), runs.size());
+              sent = send_all(fd, w.frame(MessageKind::result));
+            });
+        if (!sent) break;
+        if (bricks) ++*bricks;
+      }
+    }
+    ::close(fd);
+    return true;
+  }
+}  // namespace mgs
@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ * Distributed rendering: a coordinator and worker processes.
+ *
+ * A Coordinator listens on a local endpoint, a Unix socket
+ * ("unix:/path/to/socket") or TCP ("tcp:host:port", port 0 taking
+ * any free one), and workers (run_worker()) connect to it, from
+ * this machine or another of the same architecture. For each render
+ * the coordinator sends every worker the field's description, its
+ * bounds, stars and parameters, then hands out its bricks a few at
+ * a time, a new one each time one comes back, so the faster workers
+ * end up doing more. Once no brick is left to hand out, bricks still
+ * out are handed out again to whichever workers run dry, and the
+ * first result back wins, so a stalled worker holds nothing up.
+ *
+ * A brick's iteration counts come back run-length encoded, which
+ * shrinks the wide bands of equal counts away from the set's
+ * boundary to next to nothing, and the coordinator writes them into
+ * its Field. A worker that goes away, however it dies, has its
+ * bricks handed out again; workers may also join part way through.
+ *
+ * Only the grid is rendered remotely; channels are not sent back.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  struct DistributedOptions {
+    std::int32_t brick_size = default_brick_size;
+    // bricks out with a worker at a time, so it never waits on us
+    unsigned per_worker = 2;
+    // with no worker for this long, the render gives up
+    std::chrono::milliseconds give_up_after{30000};
+  };
+
+  struct DistributedReport {
+    std::uint64_t workers = 0;  // that took part
+    std::uint64_t lost = 0;     // went away mid-render
+    std::uint64_t bricks = 0;
+    std::uint64_t reissued = 0;  // handed out again, lost or late
+    std::uint64_t cells_bytes = 0;     // the counts, as rendered
+    std::uint64_t received_bytes = 0;  // as they came back
+  };
+
+  inline std::ostream& operator<<(std::ostream& os,
+                                  const DistributedReport& r) {
+    os << "DistributedReport[ workers:" << r.workers << " lost:" << r.lost
+       << " bricks:" << r.bricks << " reissued:" << r.reissued
+       << " cells_bytes:" << r.cells_bytes
+       << " received_bytes:" << r.received_bytes << " ]";
+    return os;
+  }
+
+  /**
+   * Run-length encoding of iteration counts, each run as the
+   * (zigzag varint) difference from the run before and its (varint)
+   * length less one.
+   */
+  std::vector<std::uint8_t> encode_runs(const iterant_t* values,
+                                        std::size_t count);
+  // false if the bytes do not decode to exactly count values
+  bool decode_runs(const std::uint8_t* bytes, std::size_t size,
+                   iterant_t* values, std::size_t count);
+
+  class Coordinator {
+   public:
+    /**
+     * Starts listening on the endpoint (see listening()). A Unix
+     * socket left over from before is replaced.
+     */
+    explicit Coordinator(const std::string& endpoint);
+    ~Coordinator();  // lets the workers go
+
+    Coordinator(const Coordinator&) = delete;
+    Coordinator& operator=(const Coordinator&) = delete;
+
+    bool listening() const { return m_listener >= 0; }
+    // as listened on, with the port filled in
+    const std::string& endpoint() const { return m_endpoint; }
+    std::size_t workers() const;
+
+    /**
+     * Renders the field's grid on the workers, waiting for them as
+     * need be; cancelled if the token is, or if there has been no
+     * worker for DistributedOptions::give_up_after, or if not
+     * listening at all.
+     */
+    RenderStatus render(StarField& field,
+                        const DistributedOptions& options = {},
+                        const CancelToken& token = {});
+
+    // of the last render
+    const DistributedReport& report() const { return m_report; }
+
+   private:
+    struct Connection;
+    std::string m_endpoint;
+    std::string m_unix_path;  // to remove, if a Unix socket
+    int m_listener = -1;
+    std::uint64_t m_job = 0;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    DistributedReport m_report;
+
+    void accept_waiting();
+  };
+
+  /**
+   * Connects to the coordinator at the endpoint and renders what it
+   * hands out until it lets go or goes away. Returns false if it
+   * could not connect; the bricks rendered are counted into bricks,
+   * if given.
+   */
+  bool run_worker(const std::string& endpoint,
+                  std::uint64_t* bricks = nullptr);
+}  // namespace mgs
@@ -0,0 +1,120 @@
+#pragma once
+
+/**
+ * Force laws: how a single star pulls on a Free Point Mass.
+ *
+ * Each is a policy reduced to one scalar, scale(r²), such that the
+ * acceleration due to a star of mass m at relative position r⃗ is
+ *
+ *   a⃗ = -G·m·r⃗ · scale(r²)
+ *
+ * which for Newtonian gravity is 1 / r³ = rsqrt(r²)³: one square root
+ * and one division per star, instead of forming the unit vector and
+ * the force separately. Like the integrators, a law is meant to be
+ * picked at compile time, as a template parameter of the acceleration
+ * kernels; with_force_law() bridges from a runtime ForceLawKind.
+ *
+ *  + Newtonian: 1 / r³, singular at the stars.
+ *  + Plummer:   1 / (r² + ε²)^(3/2), softened within about ε of a star.
+ *  + PowerLaw:  1 / (r² + ε²)^((n+1)/2), i.e. a force falling off as
+ *               1 / rⁿ, optionally softened as well.
+ *
+ * Softening also takes out the extremely close passes, where the
+ * acceleration blows up and any fixed step is far too coarse.
+ */
+
+#include <cmath>
+#include <limits>
+
+namespace mgs {
+  enum class ForceLawKind { newtonian, plummer, power_law };
+
+  template <typename T>
+  struct Newtonian {
+    static constexpr ForceLawKind kind = ForceLawKind::newtonian;
+    static constexpr const char* name = "newtonian";
+
+    Newtonian() = default;
+    Newtonian(T /*softening*/, T /*exponent*/) {}
+
+    inline T scale(const T r_squared) const {
+      const T inv_r = T(1) / std::sqrt(r_squared);
+      return inv_r * inv_r * inv_r;
+    }
+
+    /**
+     * The squared length to add to the extent of the cluster when
+     * bounding the error of treating it as a point mass (kepler.h),
+     * infinite where no such bound holds.
+     */
+    inline T far_spread_squared() const { return 0; }
+  };
+
+  template <typename T>
+  struct Plummer {
+    static constexpr ForceLawKind kind = ForceLawKind::plummer;
+    static constexpr const char* name = "plummer";
+
+    T softening_squared = 0;
+
+    Plummer() = default;
+    Plummer(T softening, T /*exponent*/)
+        : softening_squared(softening * softening) {}
+
+    inline T scale(const T r_squared) const {
+      const T inv_r = T(1) / std::sqrt(r_squared + softening_squared);
+      return inv_r * inv_r * inv_r;
+    }
+
+    // to leading order the softened pull falls short of the point
+    // mass one by 3ε² / 2r²
+    inline T far_spread_squared() const { return softening_squared * 3 / 2; }
+  };
+
+  template <typename T>
+  struct PowerLaw {
+    static constexpr ForceLawKind kind = ForceLawKind::power_law;
+    static constexpr const char* name = "power_law";
+
+    T softening_squared = 0;
+    T exponent = 2;
+
+    PowerLaw() = default;
+    PowerLaw(T softening, T n)
+        : softening_squared(softening * softening), exponent(n) {}
+
+    inline T scale(const T r_squared) const {
+      return std::pow(r_squared + softening_squared, -(exponent + 1) / 2);
+    }
+
+    // only the inverse square law has Kepler orbits
+    inline T far_spread_squared() const {
+      return exponent == 2 ? softening_squared * 3 / 2
+                           : std::numeric_limits<T>::infinity();
+    }
+  };
+
+  /**
+   * Calls f with an instance of the force law for the given kind,
+   * so the body is instantiated for each.
+   */
+  template <typename T, typename F>
+  inline decltype(auto) with_force_law(ForceLawKind kind, T softening,
+                                       T exponent, F&& f) {
+    switch (kind) {
+      case ForceLawKind::plummer:
+        return f(Plummer<T>(softening, exponent));
+      case ForceLawKind::power_law:
+        return f(PowerLaw<T>(softening, exponent));
+      case ForceLawKind::newtonian:
+      default:
+        return f(Newtonian<T>(softening, exponent));
+    }
+  }
+
+  inline const char* force_law_name(ForceLawKind kind) {
+    return with_force_law(kind, 0.0, 2.0, [](auto law) {
+      return decltype(law)::name;
+    });
+  }
+}  // namespace mgs
@@ -0,0 +1,142 @@
+#pragma once
+
+/**
+ * Integrators for advancing a Free Point Mass by one step.
+ *
+ * Each is a policy with a static step(p, v, dt, accel), where
+ * accel(p) is the acceleration kernel to use, so all of them share
+ * whichever kernel the caller supplies. They are meant to be picked
+ * at compile time, as the Integrator template parameter of
+ * render_single_cell(); with_integrator() bridges from a runtime
+ * IntegratorKind to that.
+ *
+ * The higher order integrators cost more acceleration evaluations
+ * per step, but allow for a much larger delta_t for the same
+ * classification of the field, and so fewer steps overall.
+ */
+
+#include <cmath>
+
+namespace mgs {
+  enum class IntegratorKind { euler, leapfrog, yoshida4, rk4 };
+
+  /**
+   * Semi-implicit (symplectic) Euler, the original MGS integrator:
+   * kick the velocity, then drift the position with the new velocity.
+   * First order, one evaluation per step.
+   */
+  struct Euler {
+    static constexpr IntegratorKind kind = IntegratorKind::euler;
+    static constexpr int order = 1;
+    static constexpr int evaluations = 1;
+    static constexpr const char* name = "euler";
+
+    template <typename P, typename V, typename T, typename Accel>
+    static inline void step(P& p, V& v, const T dt, Accel&& accel) {
+      v += accel(p) * dt;
+      p += v * dt;
+    }
+  };
+
+  /**
+   * Leapfrog in its drift-kick-drift form, equivalent to velocity
+   * Verlet but needing only one evaluation per step. Second order,
+   * symplectic and time reversible.
+   */
+  struct Leapfrog {
+    static constexpr IntegratorKind kind = IntegratorKind::leapfrog;
+    static constexpr int order = 2;
+    static constexpr int evaluations = 1;
+    static constexpr const char* name = "leapfrog";
+
+    template <typename P, typename V, typename T, typename Accel>
+    static inline void step(P& p, V& v, const T dt, Accel&& accel) {
+      const T half = dt / 2;
+      p += v * half;
+      v += accel(p) * dt;
+      p += v * half;
+    }
+  };
+
+  /**
+   * Yoshida's 4th order symplectic integrator, a composition of
+   * three leapfrog steps. Three evaluations per step.
+   */
+  struct Yoshida4 {
+    static constexpr IntegratorKind kind = IntegratorKind::yoshida4;
+    static constexpr int order = 4;
+    static constexpr int evaluations = 3;
+    static constexpr const char* name = "yoshida4";
+
+    template <typename P, typename V, typename T, typename Accel>
+    static inline void step(P& p, V& v, const T dt, Accel&& accel) {
+      using std::cbrt;  // or the lanes' own (see sweep.h)
+      const T cbrt2 = cbrt(T(2));
+      const T w1 = T(1) / (T(2) - cbrt2);
+      const T w0 = -cbrt2 * w1;
+      const T c1 = w1 / 2;
+      const T c2 = (w0 + w1) / 2;
+
+      p += v * (c1 * dt);
+      v += accel(p) * (w1 * dt);
+      p += v * (c2 * dt);
+      v += accel(p) * (w0 * dt);
+      p += v * (c2 * dt);
+      v += accel(p) * (w1 * dt);
+      p += v * (c1 * dt);
+    }
+  };
+
+  /**
+   * Classic 4th order Runge-Kutta on the (p, v) system. Not
+   * symplectic, four evaluations per step.
+   */
+  struct RK4 {
+    static constexpr IntegratorKind kind = IntegratorKind::rk4;
+    static constexpr int order = 4;
+    static constexpr int evaluations = 4;
+    static constexpr const char* name = "rk4";
+
+    template <typename P, typename V, typename T, typename Accel>
+    static inline void step(P& p, V& v, const T dt, Accel&& accel) {
+      const T half = dt / 2;
+      auto k1v = accel(p);
+      auto k1p = v;
+      auto k2v = accel(p + k1p * half);
+      auto k2p = v + k1v * half;
+      auto k3v = accel(p + k2p * half);
+      auto k3p = v + k2v * half;
+      auto k4v = accel(p + k3p * dt);
+      auto k4p = v + k3v * dt;
+
+      const T sixth = dt / 6;
+      p += (k1p + (k2p + k3p) * T(2) + k4p) * sixth;
+      v += (k1v + (k2v + k3v) * T(2) + k4v) * sixth;
+    }
+  };
+
+  /**
+   * Calls f with a default constructed instance of the integrator
+   * policy for the given kind, so the body is instantiated for each.
+   */
+  template <typename F>
+  inline decltype(auto) with_integrator(IntegratorKind kind, F&& f) {
+    switch (kind) {
+      case IntegratorKind::leapfrog:
+        return f(Leapfrog{});
+      case IntegratorKind::yoshida4:
+        return f(Yoshida4{});
+      case IntegratorKind::rk4:
+        return f(RK4{});
+      case IntegratorKind::euler:
+      default:
+        return f(Euler{});
+    }
+  }
+
+  inline const char* integrator_name(IntegratorKind kind) {
+    return with_integrator(kind, [](auto integrator) {
+      return decltype(integrator)::name;
+    });
+  }
+}  // namespace mgs
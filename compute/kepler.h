@@ -0,0 +1,143 @@
+#pragma once
+
+/**
+ * Analytic far-field fast forward.
+ *
+ * Far enough from the cluster, the stars pull on an FPM as a single
+ * point mass at the center of star mass would. The dipole term
+ * vanishes about the center of mass, so the relative error of that
+ * approximation falls off as (d / r)^2, d being the distance of the
+ * furthest star from the center of mass. Given a tolerance for that
+ * error we get a switch radius beyond which an outbound FPM may be
+ * propagated as a two-body (Kepler) orbit instead of step by step:
+ *
+ *  + if the orbit reaches the escape radius (unbound, or an apoapsis
+ *    beyond it), we jump straight to the time it crosses it;
+ *  + otherwise it turns around at apoapsis and comes back to its
+ *    present radius, mirrored about the apse line, and we jump to
+ *    that return and carry on stepping from there.
+ *
+ * Since the orbit only climbs above the radius it started the leg
+ * at, the error bound holds all along the leg.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "types.h"
+
+namespace mgs {
+  /**
+   * The radius (about the center of star mass) beyond which the
+   * cluster may be treated as a point mass within the tolerance.
+   * A tolerance of 0 disables the fast forward (infinite radius).
+   * spread_squared is added to the square of the cluster's extent,
+   * for force laws that differ from a point mass even for a single
+   * star (see force_laws.h).
+   */
+  template <typename T>
+  inline T kepler_switch_radius(const std::vector<Star>& stars,
+                                const Position& center_of_star_mass,
+                                const T tolerance,
+                                const T spread_squared = 0) {
+    if (tolerance <= 0) return std::numeric_limits<T>::infinity();
+    T d = 0;
+    for (const auto& star : stars)
+      d = std::max(d, T((star.position - center_of_star_mass).norm()));
+    return std::sqrt(d * d + spread_squared) / std::sqrt(tolerance);
+  }
+
+  template <typename T>
+  inline T total_star_mass(const std::vector<Star>& stars) {
+    T mass = 0;
+    for (const auto& star : stars) mass += star.mass;
+    return mass;
+  }
+
+  /**
+   * What an acceleration kernel needs to know for the fast forward:
+   * the gravitational parameter of the cluster as a whole, and the
+   * radius beyond which it may be treated as a point mass.
+   */
+  template <typename T>
+  struct FarField {
+    T mu = 0;
+    T switch_radius = std::numeric_limits<T>::infinity();
+
+    FarField() = default;
+    template <typename Law = Newtonian<T>>
+    FarField(const std::vector<Star>& stars,
+             const Position& center_of_star_mass,
+             const T gravitational_constant, const T tolerance,
+             const Law& law = Law{})
+        : mu(gravitational_constant * total_star_mass<T>(stars)),
+          switch_radius(kepler_switch_radius<T>(stars, center_of_star_mass,
+                                                tolerance,
+                                                law.far_spread_squared())) {}
+  };
+
+  template <typename T, typename V = Position>
+  struct KeplerLeg {
+    bool applicable = false;  // false: keep stepping
+    bool escapes = false;     // the leg ends at the escape radius
+    T time = 0;               // simulated time the leg takes
+    V p;                      // state at the end of a returning leg
+    V v;
+  };
+
+  /**
+   * The outbound Kepler leg of an FPM at p, v about a point mass
+   * mu = G * M at center. Not applicable unless the FPM is moving
+   * outward on a well defined (non circular, non parabolic) orbit.
+   * V may be Position or Vec3.
+   */
+  template <typename T, typename V>
+  inline KeplerLeg<T, V> kepler_outbound_leg(const V& p, const V& v,
+                                             const V& center, const T mu,
+                                             const T escape_radius) {
+    KeplerLeg<T, V> leg;
+    auto r_vec = p - center;
+    T r = r_vec.norm();
+    T rv = r_vec.dot(v);
+    if (mu <= 0 || r <= 0 || rv <= 0) return leg;
+
+    T v2 = v.norm_squared();
+    T energy = v2 / 2 - mu / r;
+    auto e_vec = (r_vec * (v2 - mu / r) - v * rv) / mu;
+    T e = e_vec.norm();
+
+    const T tiny = 1e-12;
+    if (std::abs(energy) * r / mu < tiny || e < tiny) return leg;
+
+    // time since periapsis (on the outbound branch) at radius rr
+    const bool bound = energy < 0;
+    const T a = std::abs(mu / (2 * energy));
+    const T n = std::sqrt(mu / (a * a * a));
+    const T apoapsis =
+        bound ? a * (1 + e) : std::numeric_limits<T>::infinity();
+    auto time_at = [=](T rr) {
+      if (bound) {
+        T ecc = std::acos(std::clamp((1 - rr / a) / e, T(-1), T(1)));
+        return (ecc - e * std::sin(ecc)) / n;
+      }
+      T h = std::acosh(std::max(T(1), (1 + rr / a) / e));
+      return (e * std::sinh(h) - h) / n;
+    };
+
+    leg.applicable = true;
+    if (apoapsis >= escape_radius) {
+      leg.escapes = true;
+      leg.time = time_at(escape_radius) - time_at(r);
+    } else {
+      // out to apoapsis and back again, mirrored about the apse line
+      leg.time = 2 * (time_at(apoapsis) - time_at(r));
+      auto apse = e_vec / e;
+      leg.p = center + apse * (2 * r_vec.dot(apse)) - r_vec;
+      leg.v = v - apse * (2 * v.dot(apse));
+    }
+    leg.time = std::max(leg.time, T(0));
+    return leg;
+  }
+}  // namespace mgs
@@ -13,4 +13,47 @@ namespace mgs::march {
     }
     return tetra_list;
   }
+
+  floating_t MakeTesselation::value(const Index& idx) {
+    if (auto smooth = m_field.channels.find(ChannelKind::escape_time);
+        smooth && smooth->cells() == m_field.grid.size()) {
+      float t = smooth->get(m_field.offset(idx.ijk));
+      if (!std::isnan(t)) return t;
+    }
+    return m_field[idx];
+  }
+
+  polygon_list_t MakeTesselation::isosurface_cube(const Index& idx,
+                                                  floating_t iso) {
+    polygon_list_t polygons {};
+    for (auto ti : dicer) {
+      Position corner[4];
+      floating_t v[4];
+      std::vector<int> inside, outside;
+      for (int k = 0; k < 4; ++k) {
+        Index ipos = idx + ti[k];
+        corner[k] = m_field.index2coordinate(ipos);
+        v[k] = value(ipos);
+        (v[k] >= iso ? inside : outside).push_back(k);
+      }
+      auto cross = [&](int a, int b) {
+        return edge_crossing(corner[a], corner[b], v[a], v[b], iso);
+      };
+
+      if (inside.empty() || outside.empty()) continue;
+      if (inside.size() == 2) {
+        const int a0 = inside[0], a1 = inside[1];
+        const int b0 = outside[0], b1 = outside[1];
+        polygons.push_back(
+            {cross(a0, b0), cross(a0, b1), cross(a1, b1), cross(a1, b0)});
+      } else {
+        // a lone vertex on one side, cut off by a triangle
+        const auto& lone = inside.size() == 1 ? inside : outside;
+        const auto& rest = inside.size() == 1 ? outside : inside;
+        polygons.push_back({cross(lone[0], rest[0]), cross(lone[0], rest[1]),
+                            cross(lone[0], rest[2])});
+      }
+    }
+    return polygons;
+  }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "compute.h"
 
 /**
@@ -20,6 +22,8 @@ namespace mgs::march {
   using cube_decomposer_t = std::array<tetra_index_t, 6>;
   using pos_list_t = std::vector<Position>;
   using tetra_list_t = std::vector<pos_list_t>;
+  // triangles and quads, their vertices in order around them
+  using polygon_list_t = std::vector<pos_list_t>;
 
   inline std::ostream& operator<<(std::ostream& os, pos_list_t const& pv) {
     os << "pos_list[" << '\n';
@@ -44,6 +48,21 @@ namespace mgs::march {
                                         {0b000, 0b100, 0b101, 0b111},
                                         {0b000, 0b001, 0b101, 0b111}}};
 
+  /**
+   * Where the value crosses iso along the edge from a (valued va)
+   * to b (valued vb), interpolating linearly. With integer iteration
+   * counts every crossing lands a whole step's worth along an edge,
+   * hence the stair steps; the smooth escape time puts it where the
+   * orbits actually change over.
+   */
+  inline Position edge_crossing(const Position& a, const Position& b,
+                                floating_t va, floating_t vb,
+                                floating_t iso) {
+    if (va == vb) return (a + b) / 2.0;
+    floating_t t = std::clamp((iso - va) / (vb - va), 0.0, 1.0);
+    return a + (b - a) * t;
+  }
+
   /**
    * Production is done in a pipeline fashion,
    * and later will be made lazy. All classes
@@ -72,6 +91,21 @@ namespace mgs::march {
      */
     tetra_list_t tesseltate_cube(const Index& lmp);
 
+    /**
+     * The value the isosurfaces are taken of at a point: the smooth
+     * escape time if the field has a ChannelKind::escape_time channel
+     * with a value there, the iteration count otherwise.
+     */
+    floating_t value(const Index& idx);
+
+    /**
+     * The polygons of the isosurface at iso within the cube from the
+     * lower most point, one per tetrahedron it passes through, their
+     * vertices interpolated along the tetrahedra's edges. The inside
+     * is where the value is at least iso.
+     */
+    polygon_list_t isosurface_cube(const Index& lmp, floating_t iso);
+
     template <typename Shape>
     Shape operator()() {}
   };
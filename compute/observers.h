@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * Stock step observers for render_single_cell(). Each is called
+ * with the FPM's position and velocity after every step, and keeps
+ * whatever it gathered for the caller to read afterwards:
+ *
+ *   StepCounter steps;
+ *   MinDistanceTracker closest(stars);
+ *   render_single_cell<T, I>(p, v, stars, center, parms,
+ *                            observe_all(steps, closest));
+ */
+
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  /**
+   * Counts the integration steps taken.
+   */
+  struct StepCounter {
+    std::size_t steps = 0;
+
+    inline void operator()(const Position&, const Velocity&) { ++steps; }
+  };
+
+  /**
+   * Records the orbit, keeping every nth step (every step by default).
+   */
+  struct TrajectoryRecorder {
+    std::vector<PosVel> trajectory;
+    std::size_t every;
+    std::size_t step = 0;
+
+    TrajectoryRecorder(std::size_t every_nth = 1)
+        : every(every_nth ? every_nth : 1) {}
+
+    inline void operator()(const Position& p, const Velocity& v) {
+      if (step++ % every == 0) trajectory.push_back(PosVel{p, v});
+    }
+  };
+
+  /**
+   * Tracks the closest approach of the FPM to any star, and which
+   * star that was (-1 until the first step).
+   */
+  struct MinDistanceTracker {
+    const std::vector<Star>& stars;
+    floating_t min_distance = std::numeric_limits<floating_t>::infinity();
+    int nearest_star = -1;
+
+    MinDistanceTracker(const std::vector<Star>& s) : stars(s) {}
+
+    inline void operator()(const Position& p, const Velocity&) {
+      for (std::size_t i = 0; i < stars.size(); ++i) {
+        auto d2 = (p - stars[i].position).norm_squared();
+        if (d2 < min_distance * min_distance) {
+          min_distance = std::sqrt(d2);
+          nearest_star = static_cast<int>(i);
+        }
+      }
+    }
+  };
+
+  /**
+   * Fans each step out to several observers, held by reference.
+   */
+  template <typename... Observers>
+  struct ObserverSet {
+    std::tuple<Observers&...> observers;
+
+    inline void operator()(const Position& p, const Velocity& v) {
+      std::apply([&](auto&... o) { (o(p, v), ...); }, observers);
+    }
+  };
+
+  template <typename... Observers>
+  inline ObserverSet<Observers...> observe_all(Observers&... observers) {
+    return ObserverSet<Observers...>{std::tie(observers...)};
+  }
+}  // namespace mgs
@@ -0,0 +1,283 @@
+#pragma once
+
+/**
+ * Barnes-Hut acceleration for large numbers of stars.
+ *
+ * The direct sum costs O(stars) per evaluation, which is fine for the
+ * presets but not for clusters of hundreds or thousands of stars.
+ * StarTree is an octree over the stars, each node carrying the mass,
+ * center of mass and quadrupole moment of the stars below it. An FPM
+ * far enough from a node, as judged by the opening angle theta, sees
+ * the node's multipole expansion rather than its individual stars,
+ * for O(log stars) per evaluation.
+ *
+ * The nodes are laid out depth first in a flat vector, each with the
+ * index of the node following its subtree, so the walk needs no
+ * stack: open a node by stepping to the next one, or skip it by
+ * jumping past its subtree. The tree is built once per render and
+ * only read from then on, so one tree is shared by all the workers.
+ *
+ * An opening angle of 0 opens every node, which is the direct sum
+ * (up to the order of summation).
+ *
+ * Each node also knows how far out its stars' capture radii reach,
+ * so that finding the star, if any, that has captured an FPM only
+ * descends into the nodes within reach.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "force_laws.h"
+#include "kepler.h"
+#include "types.h"
+#include "vec3.h"
+
+namespace mgs {
+  const std::size_t default_tree_leaf_size = 8;
+  const int max_tree_depth = 32;
+
+  template <typename T>
+  class StarTree {
+   public:
+    struct Node {
+      Vec3<T> com;  // center of mass
+      T mass = 0;
+      // traceless quadrupole about com: xx, yy, zz, xy, xz, yz
+      std::array<T, 6> quad{};
+      // the node is opened for FPMs closer than this to its com
+      T open_radius_squared = 0;
+      // no star below captures FPMs further than this from its com
+      T capture_reach_squared = 0;
+      std::uint32_t next = 0;  // the node after this subtree
+      std::uint32_t begin = 0, end = 0;  // its stars
+      bool leaf = false;
+    };
+
+    StarTree() = default;
+    StarTree(const std::vector<Star>& stars, const T theta,
+             const T default_capture_radius = 0,
+             const std::size_t leaf_size = default_tree_leaf_size)
+        : m_theta(theta),
+          m_capture(default_capture_radius),
+          m_leaf_size(std::max<std::size_t>(leaf_size, 1)) {
+      if (stars.empty()) return;
+      std::vector<std::uint32_t> order(stars.size());
+      std::iota(order.begin(), order.end(), 0);
+
+      Vec3<T> lo(stars[0].position), hi = lo;
+      for (const auto& star : stars) {
+        Vec3<T> p(star.position);
+        for (indexer_t d = 0; d < 3; ++d) {
+          lo[d] = std::min(lo[d], p[d]);
+          hi[d] = std::max(hi[d], p[d]);
+        }
+      }
+      T size = 0;
+      for (indexer_t d = 0; d < 3; ++d) size = std::max(size, hi[d] - lo[d]);
+      build(stars, order, 0, order.size(), (lo + hi) / T(2), size / 2, 0);
+
+      for (auto i : order) {
+        Vec3<T> p(stars[i].position);
+        sx.push_back(p.x);
+        sy.push_back(p.y);
+        sz.push_back(p.z);
+        mass.push_back(stars[i].mass);
+        T radius = capture_radius_of(stars[i], m_capture);
+        capture_squared.push_back(radius * radius);
+        has_capture |= radius > 0;
+      }
+      index = std::move(order);
+    }
+
+    const std::vector<Node>& nodes() const { return m_nodes; }
+    T theta() const { return m_theta; }
+
+    // the stars, reordered so that each leaf's are contiguous, and
+    // their indices in the original vector
+    std::vector<T> sx, sy, sz, mass, capture_squared;
+    std::vector<std::uint32_t> index;
+    bool has_capture = false;
+
+   private:
+    T m_theta = 0;
+    T m_capture = 0;
+    std::size_t m_leaf_size = default_tree_leaf_size;
+    std::vector<Node> m_nodes;
+
+    void build(const std::vector<Star>& stars,
+               std::vector<std::uint32_t>& order, std::size_t begin,
+               std::size_t end, const Vec3<T>& center, const T half,
+               const int depth) {
+      const auto self = m_nodes.size();
+      m_nodes.emplace_back();
+      {
+        Node& node = m_nodes[self];
+        node.begin = begin;
+        node.end = end;
+        moments(stars, order, node);
+        // Barnes' criterion, allowing for the com being off center
+        T offset = (node.com - center).norm();
+        T size = 2 * half;
+        T r = m_theta > 0 ? size / m_theta + offset
+                          : std::numeric_limits<T>::infinity();
+        node.open_radius_squared = r * r;
+        node.leaf = end - begin <= m_leaf_size || depth >= max_tree_depth;
+        T reach = 0;
+        for (auto k = begin; k < end; ++k) {
+          const auto& star = stars[order[k]];
+          reach = std::max(reach, (Vec3<T>(star.position) - node.com).norm() +
+                                      capture_radius_of(star, m_capture));
+        }
+        node.capture_reach_squared = reach * reach;
+      }
+
+      if (!m_nodes[self].leaf) {
+        // partition into octants, bit d set for the upper half of axis d
+        std::array<std::size_t, 9> bounds{};
+        bounds[0] = begin;
+        auto octant = [&](std::uint32_t i) {
+          Vec3<T> p(stars[i].position);
+          return int(p.x >= center.x) | int(p.y >= center.y) << 1 |
+                 int(p.z >= center.z) << 2;
+        };
+        for (int o = 0; o < 8; ++o) {
+          auto split = std::partition(
+              order.begin() + bounds[o], order.begin() + end,
+              [&](std::uint32_t i) { return octant(i) == o; });
+          bounds[o + 1] = split - order.begin();
+        }
+        for (int o = 0; o < 8; ++o) {
+          if (bounds[o] == bounds[o + 1]) continue;
+          Vec3<T> c{center.x + (o & 1 ? half : -half) / 2,
+                    center.y + (o & 2 ? half : -half) / 2,
+                    center.z + (o & 4 ? half : -half) / 2};
+          build(stars, order, bounds[o], bounds[o + 1], c, half / 2,
+                depth + 1);
+        }
+      }
+      m_nodes[self].next = m_nodes.size();
+    }
+
+    static void moments(const std::vector<Star>& stars,
+                        const std::vector<std::uint32_t>& order, Node& node) {
+      Vec3<T> weighted;
+      for (auto k = node.begin; k < node.end; ++k) {
+        const auto& star = stars[order[k]];
+        node.mass += star.mass;
+        weighted += Vec3<T>(star.position) * star.mass;
+      }
+      node.com = weighted / node.mass;
+      for (auto k = node.begin; k < node.end; ++k) {
+        const auto& star = stars[order[k]];
+        auto d = Vec3<T>(star.position) - node.com;
+        auto d2 = d.norm_squared();
+        node.quad[0] += star.mass * (3 * d.x * d.x - d2);
+        node.quad[1] += star.mass * (3 * d.y * d.y - d2);
+        node.quad[2] += star.mass * (3 * d.z * d.z - d2);
+        node.quad[3] += star.mass * 3 * d.x * d.y;
+        node.quad[4] += star.mass * 3 * d.x * d.z;
+        node.quad[5] += star.mass * 3 * d.y * d.z;
+      }
+    }
+  };
+
+  /**
+   * The acceleration kernel walking a StarTree, which it only refers
+   * to; the tree must outlive it. Leaves are summed star by star under
+   * the force law. Unopened nodes contribute their monopole under the
+   * force law, plus, for Newtonian gravity only, their quadrupole (the
+   * expansion does not carry over to the other laws, which are
+   * monopole only).
+   */
+  template <typename T, typename Law = Newtonian<T>>
+  struct TreeKernel {
+    using vector_type = Vec3<T>;
+
+    const StarTree<T>& tree;
+    T neg_g;
+    Law law;
+    FarField<T> far;
+
+    bool has_capture;
+
+    TreeKernel(const StarTree<T>& t, const std::vector<Star>& stars,
+               const Position& center, const T gc,
+               const T kepler_tolerance = 0, const Law& l = Law{})
+        : tree(t),
+          neg_g(-gc),
+          law(l),
+          far(stars, center, gc, kepler_tolerance, l),
+          has_capture(t.has_capture) {}
+
+    inline Vec3<T> operator()(const Vec3<T>& p) const {
+      Vec3<T> a;
+      const auto& nodes = tree.nodes();
+      std::size_t i = 0;
+      while (i < nodes.size()) {
+        const auto& node = nodes[i];
+        const Vec3<T> r_vec = p - node.com;
+        const T r_squared = r_vec.norm_squared();
+        if (node.leaf) {
+          for (auto k = node.begin; k < node.end; ++k) {
+            const Vec3<T> d{p.x - tree.sx[k], p.y - tree.sy[k],
+                            p.z - tree.sz[k]};
+            a += d * ((neg_g * tree.mass[k]) * law.scale(d.norm_squared()));
+          }
+          i = node.next;
+        } else if (r_squared < node.open_radius_squared) {
+          ++i;
+        } else {
+          a += r_vec * ((neg_g * node.mass) * law.scale(r_squared));
+          if constexpr (std::is_same_v<Law, Newtonian<T>>) {
+            a += quadrupole(node, r_vec, r_squared);
+          }
+          i = node.next;
+        }
+      }
+      return a;
+    }
+
+    inline star_index_t capture(const Vec3<T>& p) const {
+      const auto& nodes = tree.nodes();
+      std::size_t i = 0;
+      while (i < nodes.size()) {
+        const auto& node = nodes[i];
+        if ((p - node.com).norm_squared() >= node.capture_reach_squared) {
+          i = node.next;
+        } else if (node.leaf) {
+          for (auto k = node.begin; k < node.end; ++k) {
+            const Vec3<T> d{p.x - tree.sx[k], p.y - tree.sy[k],
+                            p.z - tree.sz[k]};
+            if (d.norm_squared() < tree.capture_squared[k])
+              return static_cast<star_index_t>(tree.index[k]);
+          }
+          i = node.next;
+        } else {
+          ++i;
+        }
+      }
+      return not_captured;
+    }
+
+   private:
+    // G [Q r / r^5 - 5/2 (r.Q.r) r / r^7]
+    inline Vec3<T> quadrupole(const typename StarTree<T>::Node& node,
+                              const Vec3<T>& r, const T r_squared) const {
+      const auto& q = node.quad;
+      const Vec3<T> qr{q[0] * r.x + q[3] * r.y + q[4] * r.z,
+                       q[3] * r.x + q[1] * r.y + q[5] * r.z,
+                       q[4] * r.x + q[5] * r.y + q[2] * r.z};
+      const T inv_r2 = T(1) / r_squared;
+      const T inv_r5 = inv_r2 * inv_r2 * std::sqrt(inv_r2);
+      const T rqr = r.dot(qr);
+      return (qr - r * (T(5) / 2 * rqr * inv_r2)) * (-neg_g * inv_r5);
+    }
+  };
+}  // namespace mgs
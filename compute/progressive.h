@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+ * Progressive (level of detail) delivery of a render.
+ *
+ * The field is rendered coarse to fine: first every 8th cell
+ * along each axis, then the cells on every 4th that were not
+ * already done, and so on down to every cell. Every cell is
+ * still computed exactly once, so the whole costs no more than
+ * a direct render. As each level completes, a LevelUpdate is
+ * pushed to each subscriber's queue, after which all the cells
+ * of that level (and the coarser ones) may be read from the grid.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mgs {
+  /**
+   * Bounded single-producer, single-consumer ring buffer. Neither
+   * side ever blocks or takes a lock; try_push() fails when the
+   * consumer has fallen Capacity entries behind.
+   */
+  template <typename T, std::size_t Capacity>
+  class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+    std::array<T, Capacity> m_ring;
+    alignas(64) std::atomic<std::size_t> m_head{0};  // next to pop
+    alignas(64) std::atomic<std::size_t> m_tail{0};  // next to push
+
+   public:
+    bool try_push(const T& value) {
+      auto tail = m_tail.load(std::memory_order_relaxed);
+      if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        return false;
+      m_ring[tail & (Capacity - 1)] = value;
+      m_tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool try_pop(T& value) {
+      auto head = m_head.load(std::memory_order_relaxed);
+      if (head == m_tail.load(std::memory_order_acquire)) return false;
+      value = m_ring[head & (Capacity - 1)];
+      m_head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool empty() const {
+      return m_head.load(std::memory_order_acquire) ==
+             m_tail.load(std::memory_order_acquire);
+    }
+  };
+
+  struct LevelUpdate {
+    std::int32_t stride = 1;  // cells that are multiples of this are done
+    std::size_t level = 0;    // 0 is the coarsest
+    std::size_t levels = 0;   // total number of levels in this render
+    std::uint64_t cells_done = 0;
+
+    bool final() const { return level + 1 == levels; }
+  };
+
+  const std::int32_t default_coarsest_stride = 8;
+
+  using LevelQueue = SpscQueue<LevelUpdate, 16>;
+  using LevelSubscriber = std::shared_ptr<LevelQueue>;
+
+  inline LevelSubscriber make_level_subscriber() {
+    return std::make_shared<LevelQueue>();
+  }
+
+  /**
+   * The strides of the levels, coarsest first, ending with 1.
+   */
+  inline std::vector<std::int32_t> level_strides(
+      std::int32_t coarsest = default_coarsest_stride) {
+    std::vector<std::int32_t> strides;
+    std::int32_t s = 1;
+    while (s * 2 <= coarsest) s *= 2;
+    for (; s >= 1; s /= 2) strides.push_back(s);
+    return strides;
+  }
+}  // namespace mgs
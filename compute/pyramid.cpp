@@ -0,0 +1,234 @@
+#include <pyramid.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace mgs {
+  FieldPyramid::FieldPyramid(const StarField& prototype,
+                             PyramidOptions options)
+      : m_prototype(prototype),
+        m_options(std::move(options)),
+        m_root_intervals(std::max<lattice_index_t>(prototype.cube_size - 1,
+                                                   1)) {
+    m_options.brick_size = std::max<std::int32_t>(m_options.brick_size, 2);
+    m_prototype.grid.clear();
+    m_prototype.grid.shrink_to_fit();
+    m_prototype.resume.keep(false);
+  }
+
+  Position FieldPyramid::spacing(std::int32_t level) const {
+    return (m_prototype.box.pm - m_prototype.box.nm) /
+           std::ldexp(floating_t(m_root_intervals), level);
+  }
+
+  lattice_index_t FieldPyramid::cells_across(std::int32_t level) const {
+    return (m_root_intervals << level) + 1;
+  }
+
+  lattice_index_t FieldPyramid::bricks_across(std::int32_t level) const {
+    return (cells_across(level) + m_options.brick_size - 1) /
+           m_options.brick_size;
+  }
+
+  Position FieldPyramid::position(std::int32_t level,
+                                  const lattice_vector_t& cell) const {
+    auto s = spacing(level);
+    Position p = (m_prototype.box.nm + m_prototype.box.pm) / 2.0;
+    for (indexer_t d = 0; d < m_prototype.dimension; ++d)
+      p[d] = m_prototype.box.nm[d] + s[d] * cell[d];
+    return p;
+  }
+
+  std::int32_t FieldPyramid::level_for(const Bounds& view,
+                                       lattice_index_t cells) const {
+    auto s = spacing(0);
+    floating_t widest = 0;  // in intervals at level 0
+    for (indexer_t d = 0; d < m_prototype.dimension; ++d)
+      widest = std::max(widest, (view.pm[d] - view.nm[d]) / s[d]);
+    if (widest <= 0) return max_pyramid_level;
+    auto level = std::ceil(std::log2(floating_t(cells - 1) / widest));
+    return static_cast<std::int32_t>(
+        std::clamp<floating_t>(level, 0, max_pyramid_level));
+  }
+
+  std::vector<PyramidBrick> FieldPyramid::bricks_in(
+      std::int32_t level, const Bounds& view) const {
+    auto s = spacing(level);
+    const lattice_index_t last = cells_across(level) - 1;
+    const lattice_index_t size = m_options.brick_size;
+    lattice_vector_t lo{}, hi{};
+    for (indexer_t d = 0; d < m_prototype.dimension; ++d) {
+      auto from = std::floor((view.nm[d] - m_prototype.box.nm[d]) / s[d]);
+      auto to = std::ceil((view.pm[d] - m_prototype.box.nm[d]) / s[d]);
+      if (to < 0 || from > floating_t(last)) return {};
+      lo[d] = std::max<lattice_index_t>(0, lattice_index_t(from)) / size;
+      hi[d] = std::min<lattice_index_t>(last, lattice_index_t(to)) / size;
+    }
+
+    std::vector<PyramidBrick> bricks;
+    PyramidBrick brick{level, lo};
+    for (;;) {
+      bricks.push_back(brick);
+      indexer_t d = 0;
+      for (; d < 3; ++d) {
+        if (brick.at[d] < hi[d]) {
+          ++brick.at[d];
+          break;
+        }
+        brick.at[d] = lo[d];
+      }
+      if (d == 3) return bricks;
+    }
+  }
+
+  /**
+   * A brick is a field of its own, brick_size cells a side, whose
+   * bounds are the lattice points at its corners.
+   */
+  std::shared_ptr<StarField> FieldPyramid::render(
+      const PyramidBrick& brick) const {
+    auto field = std::make_shared<StarField>(m_prototype);
+    const std::int32_t size = m_options.brick_size;
+    auto s = spacing(brick.level);
+    for (indexer_t d = 0; d < m_prototype.dimension; ++d) {
+      field->box.nm[d] =
+          m_prototype.box.nm[d] + s[d] * floating_t(brick.at[d] * size);
+      field->box.pm[d] = field->box.nm[d] + s[d] * (size - 1);
+    }
+    field->cube_size = size;
+    field->grid.assign(std::pow(size, field->dimension), untouched);
+
+    RenderOptions options;
+    options.threads = 1;  // bricks are rendered side by side
+    options.brick_size = size;
+    options.cache = m_options.cache;
+    field->render_with_callback(nullptr, options);
+    return field;
+  }
+
+  std::size_t FieldPyramid::request(std::int32_t level, const Bounds& view,
+                                    const CancelToken& token) {
+    auto wanted = bricks_in(level, view);
+    std::vector<PyramidBrick> missing;
+    std::uint64_t request;
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      request = ++m_requests;
+      for (const auto& brick : wanted) {
+        auto at = m_bricks.find(brick);
+        if (at == m_bricks.end()) {
+          missing.push_back(brick);
+        } else {
+          at->second.requested = request;
+          touch(at->second, brick);
+        }
+      }
+    }
+
+    RenderOptions workers;
+    workers.threads = m_options.threads;
+    std::atomic<std::size_t> rendered{0};
+    for_each_brick_parallel(
+        missing.size(), workers.worker_count(), token, [&](std::size_t i) {
+          const auto& brick = missing[i];
+          auto field = render(brick);
+          Resident resident;
+          resident.bytes = field->grid.size() * sizeof(iterant_t) +
+                           field->channels.bytes();
+          resident.requested = request;
+          resident.field = std::move(field);
+
+          std::lock_guard<std::mutex> guard(m_lock);
+          // an overlapping request may have rendered it meanwhile
+          auto at = m_bricks.find(brick);
+          if (at != m_bricks.end()) {
+            at->second.requested = request;
+            touch(at->second, brick);
+            return;
+          }
+          if (evictable(brick)) {
+            resident.used = m_recency.insert(m_recency.end(), brick);
+            m_evictable_bytes += resident.bytes;
+          }
+          m_bytes += resident.bytes;
+          m_bricks.emplace(brick, std::move(resident));
+          ++m_rendered;
+          ++rendered;
+        });
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    evict(request);
+    return rendered;
+  }
+
+  std::shared_ptr<const StarField> FieldPyramid::find(
+      const PyramidBrick& brick) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto at = m_bricks.find(brick);
+    if (at == m_bricks.end()) return nullptr;
+    touch(at->second, brick);
+    return at->second.field;
+  }
+
+  std::optional<iterant_t> FieldPyramid::at(std::int32_t level,
+                                            const lattice_vector_t& cell) {
+    const std::int32_t size = m_options.brick_size;
+    PyramidBrick brick{level, {}};
+    idx_vector_t local(m_prototype.dimension);
+    for (indexer_t d = 0; d < m_prototype.dimension; ++d) {
+      if (cell[d] < 0 || cell[d] >= cells_across(level)) return std::nullopt;
+      brick.at[d] = cell[d] / size;
+      local[d] = static_cast<indexer_t>(cell[d] % size);
+    }
+    auto field = find(brick);
+    if (!field) return std::nullopt;
+    return field->grid[field->offset(local)];
+  }
+
+  iterant_t FieldPyramid::at_best(const Coordinate& c, std::int32_t finest) {
+    for (std::int32_t level = finest; level >= 0; --level) {
+      auto s = spacing(level);
+      lattice_vector_t cell{};
+      for (indexer_t d = 0; d < m_prototype.dimension; ++d)
+        cell[d] = std::llround((c[d] - m_prototype.box.nm[d]) / s[d]);
+      auto value = at(level, cell);
+      if (value && *value != untouched) return *value;
+    }
+    return untouched;
+  }
+
+  PyramidStats FieldPyramid::stats() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return {m_bricks.size(), m_bytes, m_rendered, m_evictions};
+  }
+
+  void FieldPyramid::clear() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_bricks.clear();
+    m_recency.clear();
+    m_bytes = m_evictable_bytes = 0;
+  }
+
+  void FieldPyramid::touch(Resident& resident, const PyramidBrick& brick) {
+    if (evictable(brick))
+      m_recency.splice(m_recency.end(), m_recency, resident.used);
+  }
+
+  /**
+   * The bricks of the latest request are the most recently used,
+   * so the first of them met stops the eviction.
+   */
+  void FieldPyramid::evict(std::uint64_t keep_request) {
+    while (m_evictable_bytes > m_options.capacity_bytes &&
+           !m_recency.empty()) {
+      auto at = m_bricks.find(m_recency.front());
+      if (at->second.requested == keep_request) break;
+      m_evictable_bytes -= at->second.bytes;
+      m_bytes -= at->second.bytes;
+      m_bricks.erase(at);
+      m_recency.pop_front();
+      ++m_evictions;
+    }
+  }
+}  // namespace mgs
@@ -0,0 +1,164 @@
+#pragma once
+
+/**
+ * A multi-resolution pyramid of a field, for zooming and panning.
+ *
+ * Level 0 is the field at the resolution of the prototype it is made
+ * from; each level after has twice the resolution of the one before,
+ * over the same lattice, so that cell i of a level is cell 2i of the
+ * next. Every level is cut into bricks of brick_size cells a side,
+ * each rendered as a StarField of its own when first asked for, and
+ * only then: a view asks for the bricks it overlaps at the level
+ * that suits it (see level_for()), so a deep zoom only ever renders
+ * the bricks it looks at, never those around them or above.
+ *
+ * The coarse levels stay once rendered. The bricks of the finer ones
+ * are kept up to a capacity in bytes, evicting the least recently
+ * used first, though never those of the view just asked for. While a
+ * view's bricks are on their way, at_best() reads it from the finest
+ * level there is about each point.
+ *
+ * Bricks go through a BrickCache, if given one, so they also outlive
+ * the pyramid on disk.
+ */
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  const std::int32_t default_pyramid_brick_size = 32;
+  const std::uint64_t default_pyramid_capacity = std::uint64_t(256) << 20;
+  // far beyond where double precision gives out
+  const std::int32_t max_pyramid_level = 48;
+
+  // a cell (or brick) of a level, in lattice units on every axis
+  using lattice_index_t = std::int64_t;
+  using lattice_vector_t = std::array<lattice_index_t, 3>;
+
+  struct PyramidOptions {
+    std::int32_t brick_size = default_pyramid_brick_size;  // cells a side
+    // the levels below this stay once rendered
+    std::int32_t resident_levels = 2;
+    // for the bricks of the finer levels
+    std::uint64_t capacity_bytes = default_pyramid_capacity;
+    unsigned threads = 0;  // 0 means one per hardware thread
+    std::shared_ptr<BrickCache> cache;
+  };
+
+  struct PyramidBrick {
+    std::int32_t level = 0;
+    lattice_vector_t at{};  // in bricks
+
+    bool operator<(const PyramidBrick& o) const {
+      return level != o.level ? level < o.level : at < o.at;
+    }
+    bool operator==(const PyramidBrick& o) const {
+      return level == o.level && at == o.at;
+    }
+  };
+
+  struct PyramidStats {
+    std::size_t bricks = 0;  // resident
+    std::uint64_t bytes = 0;
+    std::uint64_t rendered = 0;
+    std::uint64_t evictions = 0;
+  };
+
+  class FieldPyramid {
+   public:
+    /**
+     * The prototype gives the bounds and resolution of level 0,
+     * and the stars, parameters and channels of every brick; its
+     * grid is not used.
+     */
+    explicit FieldPyramid(const StarField& prototype,
+                          PyramidOptions options = {});
+
+    FieldPyramid(const FieldPyramid&) = delete;
+    FieldPyramid& operator=(const FieldPyramid&) = delete;
+
+    const PyramidOptions& options() const { return m_options; }
+    // between neighbouring cells of the level, per axis
+    Position spacing(std::int32_t level) const;
+    // the lattice of the level spans [0, cells_across(level)) per axis
+    lattice_index_t cells_across(std::int32_t level) const;
+    lattice_index_t bricks_across(std::int32_t level) const;
+    Position position(std::int32_t level, const lattice_vector_t& cell) const;
+
+    /**
+     * The coarsest level at which the view is at least the given
+     * number of cells across, on its widest axis.
+     */
+    std::int32_t level_for(const Bounds& view,
+                           lattice_index_t cells_across) const;
+
+    // the bricks of the level overlapping the view, clipped to the
+    // bounds of the pyramid
+    std::vector<PyramidBrick> bricks_in(std::int32_t level,
+                                        const Bounds& view) const;
+
+    /**
+     * Makes sure the bricks of the level overlapping the view are
+     * there, rendering those that are not, in parallel, then evicts
+     * beyond the capacity. Returns the number of bricks rendered;
+     * with the token cancelled, the rest are left for next time.
+     */
+    std::size_t request(std::int32_t level, const Bounds& view,
+                        const CancelToken& token = {});
+
+    // the brick, if resident, as most recently used
+    std::shared_ptr<const StarField> find(const PyramidBrick& brick);
+
+    // the cell's value, if its brick is resident
+    std::optional<iterant_t> at(std::int32_t level,
+                                const lattice_vector_t& cell);
+
+    /**
+     * The value at the lattice point nearest c on the finest level
+     * up to the given one whose brick about it is resident, or
+     * untouched if there is none.
+     */
+    iterant_t at_best(const Coordinate& c, std::int32_t finest);
+
+    PyramidStats stats() const;
+
+    // drops every brick
+    void clear();
+
+   private:
+    struct Resident {
+      std::shared_ptr<const StarField> field;
+      std::uint64_t bytes = 0;
+      std::uint64_t requested = 0;  // the request that last wanted it
+      std::list<PyramidBrick>::iterator used;  // finer levels only
+    };
+
+    StarField m_prototype;
+    PyramidOptions m_options;
+    lattice_index_t m_root_intervals;  // across level 0
+
+    mutable std::mutex m_lock;
+    std::map<PyramidBrick, Resident> m_bricks;
+    std::list<PyramidBrick> m_recency;  // least recently used first
+    std::uint64_t m_bytes = 0;
+    std::uint64_t m_evictable_bytes = 0;
+    std::uint64_t m_requests = 0;
+    std::uint64_t m_rendered = 0;
+    std::uint64_t m_evictions = 0;
+
+    bool evictable(const PyramidBrick& brick) const {
+      return brick.level >= m_options.resident_levels;
+    }
+    std::shared_ptr<StarField> render(const PyramidBrick& brick) const;
+    void touch(Resident& resident, const PyramidBrick& brick);  // locked
+    void evict(std::uint64_t keep_request);                      // likewise
+  };
+}  // namespace mgs
@@ -0,0 +1,320 @@
+#pragma once
+
+/**
+ * Handles on renders running in the background. A RenderJob
+ * may be polled for progress, cancelled, or waited upon. The
+ * workers check the cancellation token between cells, so a
+ * cancelled render stops within the time of a single cell;
+ * the cells it did not reach are left untouched.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "brick.h"
+#include "thread_pool.h"
+
+namespace mgs {
+  /**
+   * Shared cancellation flag. Copies all refer to the
+   * same flag, so a token may be handed to as many workers
+   * (or jobs) as need to observe it.
+   */
+  class CancelToken {
+    std::shared_ptr<std::atomic<bool>> m_flag;
+
+   public:
+    CancelToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { m_flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const {
+      return m_flag->load(std::memory_order_relaxed);
+    }
+    explicit operator bool() const { return cancelled(); }
+  };
+
+  struct RenderProgress {
+    std::uint64_t cells_done = 0;
+    std::uint64_t cells_total = 0;
+    double elapsed_seconds = 0.0;
+    double eta_seconds = 0.0;  // estimated time remaining
+
+    double fraction() const {
+      return cells_total ? double(cells_done) / double(cells_total) : 1.0;
+    }
+  };
+
+  enum class RenderStatus { completed, cancelled };
+
+  /**
+   * The order the workers take the bricks in: in order of their
+   * ids, or longest first by a cost estimate from a coarse pre-pass
+   * (see scheduler.h).
+   */
+  enum class BrickSchedule { in_order, longest_first };
+
+  /**
+   * How well a render kept its workers busy, over all its passes
+   * over the bricks. A worker is idle at the tail of a pass from
+   * when it runs out of bricks to when the last one is done.
+   */
+  struct ScheduleReport {
+    unsigned workers = 0;
+    double wall_seconds = 0;
+    double busy_seconds = 0;       // summed over the workers
+    double tail_idle_seconds = 0;  // likewise
+    double estimate_seconds = 0;   // the cost pre-pass, if any
+    std::uint64_t steals = 0;
+
+    double utilisation() const {
+      return workers && wall_seconds > 0
+                 ? busy_seconds / (workers * wall_seconds)
+                 : 0.0;
+    }
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, const ScheduleReport& r) {
+    os << "ScheduleReport[ workers:" << r.workers
+       << " wall_seconds:" << r.wall_seconds
+       << " busy_seconds:" << r.busy_seconds
+       << " tail_idle_seconds:" << r.tail_idle_seconds
+       << " utilisation:" << r.utilisation();
+    if (r.estimate_seconds > 0)
+      os << " estimate_seconds:" << r.estimate_seconds;
+    os << " steals:" << r.steals << " ]";
+    return os;
+  }
+
+  /**
+   * Times the workers of one pass over the bricks for a
+   * ScheduleReport. Each worker only touches its own slot.
+   */
+  class PassTimes {
+    using clock = std::chrono::steady_clock;
+    clock::time_point m_start = clock::now();
+    std::vector<double> m_busy, m_finished;
+
+    double since_start() const {
+      return std::chrono::duration<double>(clock::now() - m_start).count();
+    }
+
+   public:
+    explicit PassTimes(unsigned workers)
+        : m_busy(workers, 0.0), m_finished(workers, 0.0) {}
+
+    template <typename F>
+    void busy(unsigned worker, F&& f) {
+      double from = since_start();
+      f();
+      m_busy[worker] += since_start() - from;
+    }
+
+    void finished(unsigned worker) { m_finished[worker] = since_start(); }
+
+    void add_to(ScheduleReport& report) const {
+      double wall = 0;
+      for (auto t : m_finished) wall = std::max(wall, t);
+      report.workers = std::max<unsigned>(report.workers, m_busy.size());
+      report.wall_seconds += wall;
+      for (std::size_t w = 0; w < m_busy.size(); ++w) {
+        report.busy_seconds += m_busy[w];
+        report.tail_idle_seconds += wall - m_finished[w];
+      }
+    }
+  };
+
+  class BrickCache;
+
+  struct RenderOptions {
+    unsigned threads = 0;  // 0 means one per hardware thread
+    std::int32_t brick_size = default_brick_size;
+    BrickSchedule schedule = BrickSchedule::in_order;
+    CancelToken token;  // pass one in to cancel from elsewhere
+    // bricks to reuse and to keep (see brick_cache.h), if any
+    std::shared_ptr<BrickCache> cache;
+    // threads to render on instead of starting new ones, if any
+    std::shared_ptr<ThreadPool> pool;
+
+    unsigned worker_count() const {
+      if (threads) return threads;
+      auto hw = std::thread::hardware_concurrency();
+      return hw ? hw : 1;
+    }
+  };
+
+  /**
+   * The state shared between a RenderJob handle and its workers.
+   */
+  struct RenderJobState {
+    using clock = std::chrono::steady_clock;
+
+    CancelToken token;
+    std::uint64_t cells_total = 0;
+    std::atomic<std::uint64_t> cells_done{0};
+    clock::time_point started = clock::now();
+    // filled in by the job as it goes; read it once finished
+    ScheduleReport schedule;
+
+    void add_done(std::uint64_t cells) {
+      cells_done.fetch_add(cells, std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * Handle on a render running in the background. Move-only;
+   * destroying a job that is still running cancels it and waits
+   * for the workers to wind down, so the Field being rendered must
+   * outlive the handle.
+   */
+  class RenderJob {
+    std::shared_ptr<RenderJobState> m_state;
+    std::shared_future<RenderStatus> m_done;
+    std::thread m_coordinator;
+
+   public:
+    RenderJob() = default;
+    RenderJob(RenderJob&&) = default;
+    RenderJob& operator=(RenderJob&& other) {
+      if (this != &other) {
+        reap();
+        m_state = std::move(other.m_state);
+        m_done = std::move(other.m_done);
+        m_coordinator = std::move(other.m_coordinator);
+      }
+      return *this;
+    }
+    RenderJob(const RenderJob&) = delete;
+    RenderJob& operator=(const RenderJob&) = delete;
+    ~RenderJob() { reap(); }
+
+    /**
+     * Starts body(state) on a coordinator thread, or runs it on the
+     * calling thread if in_place, the job returned being finished.
+     * The body is expected to do the work (typically by fanning out
+     * with for_each_brick_parallel()) and to account for it in
+     * state.cells_done.
+     */
+    template <typename Body>
+    static RenderJob launch(std::uint64_t cells_total, CancelToken token,
+                            Body&& body, bool in_place = false) {
+      RenderJob job;
+      job.m_state = std::make_shared<RenderJobState>();
+      job.m_state->token = std::move(token);
+      job.m_state->cells_total = cells_total;
+
+      std::promise<RenderStatus> promise;
+      job.m_done = promise.get_future().share();
+      auto coordinate = [state = job.m_state, promise = std::move(promise),
+                         body = std::forward<Body>(body)]() mutable {
+        body(*state);
+        promise.set_value(state->token.cancelled() ? RenderStatus::cancelled
+                                                   : RenderStatus::completed);
+      };
+      if (in_place)
+        coordinate();
+      else
+        job.m_coordinator = std::thread(std::move(coordinate));
+      return job;
+    }
+
+    bool valid() const { return m_state != nullptr; }
+    void cancel() const {
+      if (m_state) m_state->token.cancel();
+    }
+    CancelToken token() const { return m_state->token; }
+
+    bool finished() const {
+      return m_done.valid() && m_done.wait_for(std::chrono::seconds(0)) ==
+                                   std::future_status::ready;
+    }
+
+    RenderStatus wait() const { return m_done.get(); }
+    std::shared_future<RenderStatus> future() const { return m_done; }
+
+    // only to be read once the job has finished
+    ScheduleReport schedule_report() const {
+      return m_state ? m_state->schedule : ScheduleReport{};
+    }
+
+    RenderProgress progress() const {
+      RenderProgress p;
+      if (!m_state) return p;
+      p.cells_total = m_state->cells_total;
+      p.cells_done = m_state->cells_done.load(std::memory_order_relaxed);
+      p.elapsed_seconds = std::chrono::duration<double>(
+                              RenderJobState::clock::now() - m_state->started)
+                              .count();
+      if (p.cells_done)
+        p.eta_seconds = p.elapsed_seconds *
+                        double(p.cells_total - p.cells_done) /
+                        double(p.cells_done);
+      return p;
+    }
+
+   private:
+    void reap() {
+      if (m_coordinator.joinable()) {
+        // the token may be the caller's, still wanted once we are done
+        if (!finished()) cancel();
+        m_coordinator.join();
+      }
+    }
+  };
+
+  /**
+   * Runs worker(w) for each w below workers, 0 on the calling thread
+   * and the rest on the pool's threads if given one (as many of them
+   * as it has), on new ones if not.
+   */
+  template <typename F>
+  void run_workers(unsigned workers, ThreadPool* pool, F&& worker) {
+    if (pool) {
+      pool->run(workers, [&](unsigned w) { worker(w); });
+      return;
+    }
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < workers; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
+  }
+
+  /**
+   * Runs fn(brick_id) over all the bricks on the given number of
+   * threads (the calling thread being one of them), bricks being
+   * claimed dynamically. No new brick is started once the token
+   * is cancelled. The pass is added to the report, if given.
+   */
+  template <typename F>
+  void for_each_brick_parallel(std::size_t n_bricks, unsigned threads,
+                               const CancelToken& token, F&& fn,
+                               ScheduleReport* report = nullptr,
+                               ThreadPool* pool = nullptr) {
+    if (pool) threads = std::min(threads, pool->size());
+    const unsigned workers = static_cast<unsigned>(
+        std::max<std::size_t>(1, std::min<std::size_t>(threads, n_bricks)));
+    PassTimes times(report ? workers : 0);
+    std::atomic<std::size_t> next{0};
+    auto worker = [&](unsigned w) {
+      for (std::size_t b;
+           !token.cancelled() &&
+           (b = next.fetch_add(1, std::memory_order_relaxed)) < n_bricks;) {
+        if (report)
+          times.busy(w, [&] { fn(b); });
+        else
+          fn(b);
+      }
+      if (report) times.finished(w);
+    };
+
+    run_workers(workers, pool, worker);
+    if (report) times.add_to(*report);
+  }
+}  // namespace mgs
@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * Resumable iteration.
+ *
+ * Raising the iteration limit can only change the cells that reached
+ * the old one (less those captured by a star, which never escape).
+ * A ResumeTable, when kept, records where each such orbit stopped,
+ * its position, velocity and the iteration it got to, sparsely and
+ * in cell order. The next render of the same field with a higher
+ * limit then only continues those orbits from where they stopped,
+ * and leaves every other cell as it is.
+ *
+ * Positions and velocities are kept at full precision, so a resumed
+ * orbit carries on exactly as if it had never stopped. The table is
+ * not kept for adaptive renders, whose step size would be lost.
+ *
+ * The entries a render records are gathered per brick, each brick
+ * being done by one worker at a time, and collected into cell order
+ * once it completes; a cancelled render leaves no table.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "vec3.h"
+
+namespace mgs {
+  template <typename T>
+  class ResumeTable {
+   public:
+    struct Entry {
+      std::uint64_t cell;
+      std::int32_t iterations;  // integrated to, at most the limit
+      Vec3<T> p, v;
+    };
+
+    /**
+     * Whether renders are to record a table. Turning it off drops
+     * any table already recorded.
+     */
+    void keep(bool on) {
+      m_keep = on;
+      if (!on) clear();
+    }
+    bool keeping() const { return m_keep; }
+
+    void clear() {
+      m_entries.clear();
+      m_entries.shrink_to_fit();
+      m_limit = 0;
+    }
+
+    std::size_t size() const { return m_entries.size(); }
+    std::size_t bytes() const { return m_entries.size() * sizeof(Entry); }
+    const std::vector<Entry>& entries() const { return m_entries; }
+    // the limit the table was recorded at, 0 if there is none
+    std::int64_t limit() const { return m_limit; }
+
+    /**
+     * At render start: sets the table aside to be resumed from if it
+     * was recorded from a render of the same signature at a lower
+     * limit, returning that limit (0 if not resuming), and gets ready
+     * to record over the given number of bricks, if the render can be
+     * resumed at all.
+     */
+    std::int64_t begin(std::uint64_t signature, std::int64_t iter_limit,
+                       std::size_t bricks, bool resumable = true) {
+      m_previous.clear();
+      m_recording = m_keep && resumable;
+      std::int64_t from = 0;
+      if (m_recording && m_limit > 0 && m_signature == signature &&
+          iter_limit > m_limit) {
+        m_previous.swap(m_entries);
+        from = m_limit;
+      }
+      clear();
+      m_signature = signature;
+      m_pending_limit = iter_limit;
+      m_bricks.assign(m_recording ? bricks : 0, {});
+      return from;
+    }
+
+    bool recording() const { return m_recording; }
+
+    // the saved state of the cell, if the render is resuming it
+    const Entry* find(std::uint64_t cell) const {
+      auto at = std::lower_bound(
+          m_previous.begin(), m_previous.end(), cell,
+          [](const Entry& e, std::uint64_t c) { return e.cell < c; });
+      return at != m_previous.end() && at->cell == cell ? &*at : nullptr;
+    }
+
+    // from the worker rendering the brick
+    void record(std::size_t brick, const Entry& entry) {
+      m_bricks[brick].push_back(entry);
+    }
+
+    /**
+     * At render end: collects what the bricks recorded, if the
+     * render completed.
+     */
+    void finish(bool completed) {
+      m_previous.clear();
+      m_previous.shrink_to_fit();
+      if (m_recording && completed) {
+        std::size_t n = 0;
+        for (const auto& b : m_bricks) n += b.size();
+        m_entries.reserve(n);
+        for (const auto& b : m_bricks)
+          m_entries.insert(m_entries.end(), b.begin(), b.end());
+        std::sort(
+            m_entries.begin(), m_entries.end(),
+            [](const Entry& a, const Entry& b) { return a.cell < b.cell; });
+        m_limit = m_pending_limit;
+      }
+      m_bricks.clear();
+      m_bricks.shrink_to_fit();
+      m_recording = false;
+    }
+
+   private:
+    bool m_keep = false;
+    bool m_recording = false;
+    std::uint64_t m_signature = 0;
+    std::int64_t m_limit = 0;
+    std::int64_t m_pending_limit = 0;
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_previous;
+    std::vector<std::vector<Entry>> m_bricks;
+  };
+}  // namespace mgs
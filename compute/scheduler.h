@@ -0,0 +1,139 @@
+#pragma once
+
+/**
+ * Cost-predictive brick scheduling.
+ *
+ * The cost of a cell ranges over orders of magnitude, from no steps
+ * at all for one starting outside the escape radius to the whole
+ * iteration limit for a bound one, so bricks differ as widely. Taken
+ * in order, a costly brick claimed near the end keeps one worker
+ * busy long after the rest have run dry.
+ *
+ * Given an estimate of the cost of each brick (see
+ * Field::estimate_brick_costs()), for_each_brick_longest_first()
+ * deals the bricks out longest first, each to the worker with the
+ * least estimated work so far, and each worker then takes its own
+ * bricks longest first. A worker running out steals the cheapest
+ * remaining brick of the worker with the most estimated work left,
+ * which absorbs whatever the estimates got wrong.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "brick.h"
+#include "render_job.h"
+
+namespace mgs {
+  /**
+   * As for_each_brick_parallel(), over as many bricks as there are
+   * costs.
+   */
+  template <typename F>
+  void for_each_brick_longest_first(const std::vector<double>& costs,
+                                    unsigned threads,
+                                    const CancelToken& token, F&& fn,
+                                    ScheduleReport* report = nullptr,
+                                    ThreadPool* pool = nullptr) {
+    if (pool) threads = std::min(threads, pool->size());
+    const std::size_t n_bricks = costs.size();
+    const unsigned workers = static_cast<unsigned>(
+        std::max<std::size_t>(1, std::min<std::size_t>(threads, n_bricks)));
+
+    struct Queue {
+      std::mutex lock;
+      std::deque<brick_id_t> bricks;  // most costly first
+      double load = 0;                // their estimated cost
+    };
+    std::vector<Queue> queues(workers);
+
+    std::vector<brick_id_t> order(n_bricks);
+    std::iota(order.begin(), order.end(), brick_id_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+      return costs[a] > costs[b];
+    });
+    for (auto b : order) {
+      auto least = std::min_element(
+          queues.begin(), queues.end(),
+          [](const Queue& x, const Queue& y) { return x.load < y.load; });
+      least->bricks.push_back(b);
+      least->load += costs[b];
+    }
+
+    auto take = [&](unsigned w, brick_id_t& b) {
+      Queue& own = queues[w];
+      std::lock_guard<std::mutex> guard(own.lock);
+      if (own.bricks.empty()) return false;
+      b = own.bricks.front();
+      own.bricks.pop_front();
+      own.load -= costs[b];
+      return true;
+    };
+    std::atomic<std::uint64_t> steals{0};
+    auto steal = [&](unsigned w, brick_id_t& b) {
+      for (;;) {
+        // the victim with the most work left
+        Queue* victim = nullptr;
+        double most = 0;
+        for (unsigned v = 0; v < workers; ++v) {
+          if (v == w) continue;
+          std::lock_guard<std::mutex> guard(queues[v].lock);
+          if (!queues[v].bricks.empty() &&
+              (!victim || queues[v].load > most)) {
+            victim = &queues[v];
+            most = queues[v].load;
+          }
+        }
+        if (!victim) return false;
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (victim->bricks.empty()) continue;  // beaten to it
+        b = victim->bricks.back();
+        victim->bricks.pop_back();
+        victim->load -= costs[b];
+        steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    };
+
+    PassTimes times(report ? workers : 0);
+    auto worker = [&](unsigned w) {
+      brick_id_t b;
+      while (!token.cancelled() && (take(w, b) || steal(w, b))) {
+        if (report)
+          times.busy(w, [&] { fn(b); });
+        else
+          fn(b);
+      }
+      if (report) times.finished(w);
+    };
+
+    run_workers(workers, pool, worker);
+    if (report) {
+      times.add_to(*report);
+      report->steals += steals.load();
+    }
+  }
+
+  /**
+   * Runs fn over the bricks longest first if they have costs, in
+   * order otherwise.
+   */
+  template <typename F>
+  void for_each_brick_scheduled(std::size_t n_bricks,
+                                const std::vector<double>& costs,
+                                unsigned threads, const CancelToken& token,
+                                F&& fn, ScheduleReport* report = nullptr,
+                                ThreadPool* pool = nullptr) {
+    if (costs.size() == n_bricks && n_bricks > 0)
+      for_each_brick_longest_first(costs, threads, token,
+                                   std::forward<F>(fn), report, pool);
+    else
+      for_each_brick_parallel(n_bricks, threads, token, std::forward<F>(fn),
+                              report, pool);
+  }
+}  // namespace mgs
@@ -0,0 +1,227 @@
+#include <shared_field.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace mgs {
+  namespace {
+    const std::uint32_t shared_field_magic = 0x4653474d;  // "MGSF"
+    // the grid starts on a cache line of its own
+    const std::size_t grid_offset = 256;
+  }  // namespace
+
+  struct SharedFieldHeader {
+    std::atomic<std::uint32_t> magic;  // set last, once ready to read
+    std::uint32_t version;
+    std::uint32_t iterant_size;
+    indexer_t cube_size;
+    indexer_t dimension;
+    double nm[3];
+    double pm[3];
+    std::uint64_t cells;
+    std::atomic<std::uint64_t> generation;  // odd while publishing
+    std::atomic<std::uint64_t> bricks;
+    std::atomic<std::uint32_t> complete;
+  };
+
+  static_assert(sizeof(SharedFieldHeader) <= grid_offset,
+                "the header runs into the grid");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "the counters are shared between processes");
+
+  namespace {
+    std::size_t offset_in(const SharedFieldHeader& h,
+                          const idx_vector_t& ijk) {
+      std::size_t off = 0;
+      std::size_t r = 1;
+      for (indexer_t d = 0; d < h.dimension; ++d) {
+        off += ijk[d] * r;
+        r *= h.cube_size;
+      }
+      return off;
+    }
+  }  // namespace
+
+  SharedFieldWriter::SharedFieldWriter(const std::string& name,
+                                       const StarField& field,
+                                       bool remove_when_done)
+      : m_name(name), m_remove(remove_when_done) {
+    const auto cells = static_cast<std::uint64_t>(
+        std::pow(field.cube_size, field.dimension));
+    m_bytes = grid_offset + cells * sizeof(iterant_t);
+
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return;
+    void* mapped = MAP_FAILED;
+    if (::ftruncate(fd, m_bytes) == 0)
+      mapped = ::mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      ::shm_unlink(name.c_str());
+      return;
+    }
+
+    m_header = new (mapped) SharedFieldHeader{};
+    m_grid = reinterpret_cast<iterant_t*>(static_cast<char*>(mapped) +
+                                          grid_offset);
+    m_header->version = kernel_version;
+    m_header->iterant_size = sizeof(iterant_t);
+    m_header->cube_size = field.cube_size;
+    m_header->dimension = field.dimension;
+    const auto& nm = field.box.nm.vec;
+    const auto& pm = field.box.pm.vec;
+    for (std::size_t d = 0; d < 3; ++d) {
+      m_header->nm[d] = d < nm.size() ? nm[d] : 0;
+      m_header->pm[d] = d < pm.size() ? pm[d] : 0;
+    }
+    m_header->cells = cells;
+    std::fill_n(m_grid, cells, iterant_t(untouched));
+    m_header->magic.store(shared_field_magic, std::memory_order_release);
+  }
+
+  SharedFieldWriter::~SharedFieldWriter() {
+    if (!m_header) return;
+    ::munmap(m_header, m_bytes);
+    if (m_remove) ::shm_unlink(m_name.c_str());
+  }
+
+  void SharedFieldWriter::publish(const Brick& brick,
+                                  Span<const iterant_t> counts) {
+    if (!m_header || counts.size() != brick.cells()) return;
+    std::lock_guard<std::mutex> guard(m_publishing);
+    auto& generation = m_header->generation;
+    const auto g = generation.load(std::memory_order_relaxed);
+    generation.store(g + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const std::size_t row_length = brick.extent[0];
+    for_each_row(brick, [&](const idx_vector_t& row, std::size_t local) {
+      std::copy_n(counts.data() + local, row_length,
+                  m_grid + offset_in(*m_header, row));
+    });
+    generation.store(g + 2, std::memory_order_release);
+    m_header->bricks.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void SharedFieldWriter::publish(const StarField& field) {
+    if (!m_header || field.grid.size() != m_header->cells) return;
+    std::lock_guard<std::mutex> guard(m_publishing);
+    auto& generation = m_header->generation;
+    const auto g = generation.load(std::memory_order_relaxed);
+    generation.store(g + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::copy(field.grid.begin(), field.grid.end(), m_grid);
+    generation.store(g + 2, std::memory_order_release);
+  }
+
+  void SharedFieldWriter::finish() {
+    if (m_header) m_header->complete.store(1, std::memory_order_release);
+  }
+
+  StarField::brick_callback_t SharedFieldWriter::publisher() {
+    return [this](const Brick& brick, Span<const iterant_t> counts) {
+      publish(brick, counts);
+    };
+  }
+
+  SharedFieldView::SharedFieldView(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return;
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (::fstat(fd, &status) == 0 &&
+        std::size_t(status.st_size) >= grid_offset) {
+      m_bytes = status.st_size;
+      mapped = ::mmap(nullptr, m_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) return;
+
+    auto* header = static_cast<const SharedFieldHeader*>(mapped);
+    if (header->magic.load(std::memory_order_acquire) != shared_field_magic ||
+        header->version != kernel_version ||
+        header->iterant_size != sizeof(iterant_t) ||
+        header->cells > (m_bytes - grid_offset) / sizeof(iterant_t)) {
+      ::munmap(mapped, m_bytes);
+      return;
+    }
+    m_header = header;
+    m_grid = reinterpret_cast<const iterant_t*>(
+        static_cast<const char*>(mapped) + grid_offset);
+  }
+
+  SharedFieldView::~SharedFieldView() {
+    if (m_header)
+      ::munmap(const_cast<SharedFieldHeader*>(m_header), m_bytes);
+  }
+
+  indexer_t SharedFieldView::cube_size() const { return m_header->cube_size; }
+  indexer_t SharedFieldView::dimension() const { return m_header->dimension; }
+  std::size_t SharedFieldView::cells() const { return m_header->cells; }
+
+  Bounds SharedFieldView::box() const {
+    Bounds box;
+    box.nm.vec.assign(m_header->nm, m_header->nm + 3);
+    box.pm.vec.assign(m_header->pm, m_header->pm + 3);
+    return box;
+  }
+
+  std::uint64_t SharedFieldView::generation() const {
+    return m_header->generation.load(std::memory_order_acquire);
+  }
+
+  std::uint64_t SharedFieldView::bricks() const {
+    return m_header->bricks.load(std::memory_order_relaxed);
+  }
+
+  bool SharedFieldView::complete() const {
+    return m_header->complete.load(std::memory_order_acquire) != 0;
+  }
+
+  std::uint64_t SharedFieldView::begin_read() const {
+    return m_header->generation.load(std::memory_order_acquire);
+  }
+
+  bool SharedFieldView::end_read(std::uint64_t before) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_header->generation.load(std::memory_order_relaxed) == before;
+  }
+
+  bool SharedFieldView::read(std::vector<iterant_t>& out,
+                             unsigned tries) const {
+    if (!m_header) return false;
+    out.resize(m_header->cells);
+    return read_consistent(
+        [&](const iterant_t* grid) {
+          std::copy_n(grid, out.size(), out.begin());
+        },
+        tries);
+  }
+
+  bool SharedFieldView::read(const Brick& brick, std::vector<iterant_t>& out,
+                             unsigned tries) const {
+    if (!m_header) return false;
+    out.resize(brick.cells());
+    const std::size_t row_length = brick.extent[0];
+    return read_consistent(
+        [&](const iterant_t* grid) {
+          for_each_row(brick, [&](const idx_vector_t& row,
+                                  std::size_t local) {
+            std::copy_n(grid + offset_in(*m_header, row), row_length,
+                        out.begin() + local);
+          });
+        },
+        tries);
+  }
+
+  bool remove_shared_field(const std::string& name) {
+    return ::shm_unlink(name.c_str()) == 0;
+  }
+}  // namespace mgs
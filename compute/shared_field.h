@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * Fields shared between processes through POSIX shared memory.
+ *
+ * A renderer makes a named segment for a field (SharedFieldWriter)
+ * holding a header, the field's size and bounds, and its grid, and
+ * publishes bricks into it as they come off the render, or the
+ * whole grid at once. A viewer maps the same segment read only
+ * (SharedFieldView) and reads the grid where it lies, without a
+ * copy, however large, while the render goes on.
+ *
+ * Consistency is by a seqlock: the header's generation counter is
+ * odd while a publish is under way and moves on to the next even
+ * number once it is over. A reader wanting cells as of a moment no
+ * publish was under way reads them between two loads of the counter
+ * and tries again unless both found it the same, and even; one that
+ * only wants a picture, say to draw each frame, can read as it
+ * pleases and at worst see a brick part way in.
+ *
+ * Segment names are as for shm_open(): a slash, then no other.
+ */
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  struct SharedFieldHeader;
+
+  class SharedFieldWriter {
+   public:
+    /**
+     * Makes the segment, replacing any of the same name, for a field
+     * of this one's size and bounds, every cell untouched. Removed
+     * again on destruction if remove_when_done, though views already
+     * made keep it until they go.
+     */
+    SharedFieldWriter(const std::string& name, const StarField& field,
+                      bool remove_when_done = true);
+    ~SharedFieldWriter();
+
+    SharedFieldWriter(const SharedFieldWriter&) = delete;
+    SharedFieldWriter& operator=(const SharedFieldWriter&) = delete;
+
+    bool valid() const { return m_header != nullptr; }
+    const std::string& name() const { return m_name; }
+
+    // the brick's counts, laid out as a brick callback has them
+    void publish(const Brick& brick, Span<const iterant_t> counts);
+    void publish(const StarField& field);  // the whole grid
+    void finish();                         // nothing more to come
+
+    // publish(), as a brick callback for a render; safe across threads
+    StarField::brick_callback_t publisher();
+
+   private:
+    std::string m_name;
+    bool m_remove;
+    std::size_t m_bytes = 0;
+    SharedFieldHeader* m_header = nullptr;
+    iterant_t* m_grid = nullptr;
+    std::mutex m_publishing;  // a seqlock has one writer at a time
+  };
+
+  class SharedFieldView {
+   public:
+    // maps the segment read only; not valid() until its writer has made it
+    explicit SharedFieldView(const std::string& name);
+    ~SharedFieldView();
+
+    SharedFieldView(const SharedFieldView&) = delete;
+    SharedFieldView& operator=(const SharedFieldView&) = delete;
+
+    bool valid() const { return m_header != nullptr; }
+
+    indexer_t cube_size() const;
+    indexer_t dimension() const;
+    Bounds box() const;
+    std::size_t cells() const;
+    std::uint64_t generation() const;
+    std::uint64_t bricks() const;  // published so far
+    bool complete() const;         // the writer has finished
+
+    // the grid, live, as StarField::grid lays it out
+    const iterant_t* grid() const { return m_grid; }
+
+    /**
+     * Calls read(grid()) until it runs start to end with no publish
+     * under way, up to tries times; false if it never did.
+     */
+    template <typename F>
+    bool read_consistent(F&& read, unsigned tries = 1000) const {
+      for (unsigned t = 0; t < tries; ++t) {
+        auto before = begin_read();
+        if (before & 1) continue;
+        read(m_grid);
+        if (end_read(before)) return true;
+      }
+      return false;
+    }
+
+    // a consistent copy of the grid, or of the cells of one brick
+    bool read(std::vector<iterant_t>& out, unsigned tries = 1000) const;
+    bool read(const Brick& brick, std::vector<iterant_t>& out,
+              unsigned tries = 1000) const;
+
+   private:
+    std::size_t m_bytes = 0;
+    const SharedFieldHeader* m_header = nullptr;
+    const iterant_t* m_grid = nullptr;
+
+    std::uint64_t begin_read() const;
+    bool end_read(std::uint64_t before) const;
+  };
+
+  // removes the named segment, for when its writer was told to leave it
+  bool remove_shared_field(const std::string& name);
+}  // namespace mgs
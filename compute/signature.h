@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * Signatures: 64 bit FNV-1a hashes of whatever goes into a render,
+ * to tell whether results kept from one render still hold for
+ * another. Values are added one by one, never as whole structs
+ * (whose padding is undefined), floating point ones by their bits.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mgs {
+  class Signature {
+   public:
+    template <typename V>
+    Signature& add(const V& value) {
+      static_assert(std::is_arithmetic_v<V> || std::is_enum_v<V>,
+                    "add the members one by one");
+      unsigned char bytes[sizeof(V)];
+      std::memcpy(bytes, &value, sizeof(V));
+      for (auto b : bytes) {
+        m_hash ^= b;
+        m_hash *= 0x100000001b3ull;
+      }
+      return *this;
+    }
+
+    std::uint64_t value() const { return m_hash; }
+
+   private:
+    std::uint64_t m_hash = 0xcbf29ce484222325ull;
+  };
+}  // namespace mgs
@@ -0,0 +1,237 @@
+#pragma once
+
+/**
+ * Acceleration kernels: the sum over the stars that every
+ * integration step evaluates.
+ *
+ * A kernel is a callable taking the FPM's position and returning
+ * its acceleration, in the kernel's vector_type, and carrying the
+ * FarField the Kepler fast forward needs. All the shipped presets
+ * have a small fixed number of stars (4, 6, 8, 12 or 20), for which
+ * FixedStarKernel keeps the stars in std::arrays, so the loop over
+ * them is fully unrolled and the star data stays in registers or L1.
+ * Any other count gets DynamicStarKernel, the same loop over a
+ * std::vector. Large clusters are better served by the TreeKernel
+ * of octree.h. with_star_kernel() picks one once, at render start.
+ *
+ * Kernels also tell which star, if any, has captured an FPM at a
+ * given position, through has_capture and capture(p); see
+ * Star::capture_radius.
+ *
+ * All of them are templated on the force law (force_laws.h), and
+ * compute exactly what compute_acceleration() does, in the same
+ * order, so the results match render_single_cell() bit for bit.
+ */
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "kepler.h"
+#include "octree.h"
+#include "types.h"
+#include "vec3.h"
+
+namespace mgs {
+  /**
+   * The generic kernel over std::vector<Star> and Position, as used
+   * by render_single_cell().
+   */
+  template <typename T, typename I, typename Law = Newtonian<T>>
+  struct DirectSumKernel {
+    using vector_type = Position;
+
+    const std::vector<Star>& stars;
+    T gravitational_constant;
+    Law law;
+    FarField<T> far;
+    T default_capture;
+    bool has_capture = false;
+
+    DirectSumKernel(const std::vector<Star>& s, const Position& center,
+                    const T gc, const T kepler_tolerance = 0,
+                    const Law& l = Law{}, const T default_capture_radius = 0)
+        : stars(s),
+          gravitational_constant(gc),
+          law(l),
+          far(s, center, gc, kepler_tolerance, l),
+          default_capture(default_capture_radius) {
+      for (const auto& star : stars)
+        has_capture |= capture_radius_of(star, default_capture) > 0;
+    }
+
+    inline Acceleration operator()(const Position& p) const {
+      return total_acceleration<T, I>(stars, p, gravitational_constant, law);
+    }
+
+    inline star_index_t capture(const Position& p) const {
+      for (std::size_t i = 0; i < stars.size(); ++i) {
+        T radius = capture_radius_of(stars[i], default_capture);
+        if ((p - stars[i].position).norm_squared() < radius * radius)
+          return static_cast<star_index_t>(i);
+      }
+      return not_captured;
+    }
+  };
+
+  /**
+   * The pull of a single star of mass neg_gm = -G * m at s.
+   */
+  template <typename T, typename Law>
+  inline Vec3<T> star_acceleration(const Vec3<T>& p, const T sx, const T sy,
+                                   const T sz, const T neg_gm,
+                                   const Law& law) {
+    const Vec3<T> r_vec{p.x - sx, p.y - sy, p.z - sz};
+    return r_vec * (neg_gm * law.scale(r_vec.norm_squared()));
+  }
+
+  template <typename T, std::size_t N, typename Law = Newtonian<T>>
+  struct FixedStarKernel {
+    using vector_type = Vec3<T>;
+    static constexpr std::size_t star_count = N;
+
+    std::array<T, N> sx, sy, sz, neg_gm, capture_squared;
+    Law law;
+    FarField<T> far;
+    bool has_capture = false;
+
+    FixedStarKernel(const std::vector<Star>& stars, const Position& center,
+                    const T gc, const T kepler_tolerance = 0,
+                    const Law& l = Law{}, const T default_capture_radius = 0)
+        : law(l), far(stars, center, gc, kepler_tolerance, l) {
+      for (std::size_t i = 0; i < N; ++i) {
+        sx[i] = stars[i].position[0];
+        sy[i] = stars[i].position[1];
+        sz[i] = stars[i].position[2];
+        neg_gm[i] = (-gc) * stars[i].mass;
+        T radius = capture_radius_of(stars[i], default_capture_radius);
+        capture_squared[i] = radius * radius;
+        has_capture |= radius > 0;
+      }
+    }
+
+    inline Vec3<T> operator()(const Vec3<T>& p) const {
+      return sum(p, std::make_index_sequence<N>{});
+    }
+
+    inline star_index_t capture(const Vec3<T>& p) const {
+      for (std::size_t i = 0; i < N; ++i) {
+        const Vec3<T> d{p.x - sx[i], p.y - sy[i], p.z - sz[i]};
+        if (d.norm_squared() < capture_squared[i])
+          return static_cast<star_index_t>(i);
+      }
+      return not_captured;
+    }
+
+   private:
+    template <std::size_t... S>
+    inline Vec3<T> sum(const Vec3<T>& p, std::index_sequence<S...>) const {
+      Vec3<T> a;
+      ((a += star_acceleration(p, sx[S], sy[S], sz[S], neg_gm[S], law)), ...);
+      return a;
+    }
+  };
+
+  template <typename T, typename Law = Newtonian<T>>
+  struct DynamicStarKernel {
+    using vector_type = Vec3<T>;
+
+    std::vector<T> sx, sy, sz, neg_gm, capture_squared;
+    Law law;
+    FarField<T> far;
+    bool has_capture = false;
+
+    DynamicStarKernel(const std::vector<Star>& stars, const Position& center,
+                      const T gc, const T kepler_tolerance = 0,
+                      const Law& l = Law{}, const T default_capture_radius = 0)
+        : law(l), far(stars, center, gc, kepler_tolerance, l) {
+      for (const auto& star : stars) {
+        sx.push_back(star.position[0]);
+        sy.push_back(star.position[1]);
+        sz.push_back(star.position[2]);
+        neg_gm.push_back((-gc) * star.mass);
+        T radius = capture_radius_of(star, default_capture_radius);
+        capture_squared.push_back(radius * radius);
+        has_capture |= radius > 0;
+      }
+    }
+
+    inline Vec3<T> operator()(const Vec3<T>& p) const {
+      Vec3<T> a;
+      const std::size_t n = neg_gm.size();
+      for (std::size_t i = 0; i < n; ++i)
+        a += star_acceleration(p, sx[i], sy[i], sz[i], neg_gm[i], law);
+      return a;
+    }
+
+    inline star_index_t capture(const Vec3<T>& p) const {
+      const std::size_t n = capture_squared.size();
+      for (std::size_t i = 0; i < n; ++i) {
+        const Vec3<T> d{p.x - sx[i], p.y - sy[i], p.z - sz[i]};
+        if (d.norm_squared() < capture_squared[i])
+          return static_cast<star_index_t>(i);
+      }
+      return not_captured;
+    }
+  };
+
+  /**
+   * Calls f with the kernel best suited to the number of stars.
+   */
+  template <typename T, typename Law, typename F>
+  inline decltype(auto) with_star_kernel(const std::vector<Star>& stars,
+                                         const Position& center,
+                                         const T gravitational_constant,
+                                         const T kepler_tolerance,
+                                         const Law& law,
+                                         const T default_capture_radius,
+                                         F&& f) {
+    const auto& gc = gravitational_constant;
+    const auto& tol = kepler_tolerance;
+    const auto& cap = default_capture_radius;
+    switch (stars.size()) {
+      case 4:
+        return f(FixedStarKernel<T, 4, Law>(stars, center, gc, tol, law, cap));
+      case 6:
+        return f(FixedStarKernel<T, 6, Law>(stars, center, gc, tol, law, cap));
+      case 8:
+        return f(FixedStarKernel<T, 8, Law>(stars, center, gc, tol, law, cap));
+      case 12:
+        return f(
+            FixedStarKernel<T, 12, Law>(stars, center, gc, tol, law, cap));
+      case 20:
+        return f(
+            FixedStarKernel<T, 20, Law>(stars, center, gc, tol, law, cap));
+      default:
+        return f(DynamicStarKernel<T, Law>(stars, center, gc, tol, law, cap));
+    }
+  }
+
+  /**
+   * As above, for the force law the field parameters call for, and
+   * walking the given tree instead of summing directly if there is
+   * one (which must have been built with parms.capture_radius).
+   */
+  template <typename T, typename I, typename F>
+  inline decltype(auto) with_star_kernel(const std::vector<Star>& stars,
+                                         const Position& center,
+                                         const FieldParms<T, I>& parms,
+                                         F&& f,
+                                         const StarTree<T>* tree = nullptr) {
+    return with_force_law(
+        parms.force_law, parms.softening, parms.force_exponent,
+        [&](const auto& law) -> decltype(auto) {
+          if (tree) {
+            using Law = std::decay_t<decltype(law)>;
+            return f(TreeKernel<T, Law>(*tree, stars, center,
+                                        parms.gravitational_constant,
+                                        parms.kepler_tolerance, law));
+          }
+          return with_star_kernel<T>(
+              stars, center, parms.gravitational_constant,
+              parms.kepler_tolerance, law, parms.capture_radius, f);
+        });
+  }
+}  // namespace mgs
@@ -0,0 +1,118 @@
+#include <sweep.h>
+
+#include <algorithm>
+
+namespace mgs {
+  bool sweeps_in_lanes(const StarField& field) {
+    const auto& parms = field.parms;
+    return !parms.adaptive && parms.kepler_tolerance <= 0 &&
+           parms.opening_angle <= 0 && parms.accel_grid_size <= 0 &&
+           field.channels.empty();
+  }
+
+  namespace {
+    using T = floating_t;
+    using I = iterant_t;
+
+    // what a lane needs of a parameter set
+    struct SweepLane {
+      Vec3<T> center;
+      T delta_t;
+      std::vector<T> neg_gm;
+    };
+
+    template <typename Integrator, typename Law>
+    void sweep_bricks(const StarField& field, const BrickLayout& layout,
+                      std::vector<StarField>& fields, const Law& law,
+                      const RenderOptions& options) {
+      std::vector<SweepLane> lanes;
+      for (const auto& lane : fields) {
+        lanes.push_back({Vec3<T>(lane.center_of_star_mass),
+                         lane.parms.delta_t, {}});
+        for (const auto& star : lane.stars)
+          lanes.back().neg_gm.push_back(
+              (-lane.parms.gravitational_constant) * star.mass);
+      }
+      const std::size_t points = fields.size();
+
+      for_each_brick_parallel(
+          layout.size(), options.worker_count(), options.token,
+          [&](brick_id_t b) {
+            // the orbits are the brick's cells, each under every point
+            std::vector<Vec3<T>> positions;
+            std::vector<std::size_t> offsets;
+            for_each_cell(layout[b], [&](const idx_vector_t& ijk) {
+              positions.emplace_back(field.cell_position(ijk));
+              offsets.push_back(field.offset(ijk));
+            });
+            const std::size_t orbits = positions.size() * points;
+            std::size_t taken = 0;
+            std::array<std::size_t, sweep_lanes> orbit_of;
+
+            LaneStarKernel<T, sweep_lanes, Law> kernel(
+                field.stars, law, field.parms.capture_radius);
+            integrate_lanes<T, I, Integrator>(
+                kernel, field.parms.iter_limit, field.parms.escape_radius,
+                [&](std::size_t l, LaneOrbit<T>& orbit) {
+                  if (taken == orbits || options.token.cancelled())
+                    return false;
+                  const auto& lane = lanes[taken % points];
+                  orbit = {positions[taken / points], lane.center,
+                           lane.delta_t, lane.neg_gm.data()};
+                  orbit_of[l] = taken++;
+                  return true;
+                },
+                [&](std::size_t l, I count) {
+                  const std::size_t o = orbit_of[l];
+                  fields[o % points].grid[offsets[o / points]] = count;
+                });
+          },
+          nullptr, options.pool.get());
+    }
+  }  // namespace
+
+  RenderStatus render_sweep(const StarField& field,
+                            const std::vector<SweepPoint>& points,
+                            std::vector<StarField>& fields,
+                            const RenderOptions& options) {
+    const BrickLayout layout(field.cube_size, field.dimension,
+                             options.brick_size);
+    fields.clear();
+    for (const auto& point : points)
+      if (!point.star_masses.empty() &&
+          point.star_masses.size() != field.stars.size())
+        return RenderStatus::cancelled;  // not a mass for every star
+    fields.assign(points.size(), field);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      auto& lane = fields[i];
+      lane.parms.gravitational_constant = points[i].gravitational_constant;
+      lane.parms.delta_t = points[i].delta_t;
+      if (!points[i].star_masses.empty())
+        for (std::size_t s = 0; s < lane.stars.size(); ++s)
+          lane.stars[s].mass = points[i].star_masses[s];
+      lane.center_of_star_mass =
+          compute_center_of_star_mass<T, indexer_t>(lane.stars);
+      lane.grid.assign(layout.cells(), I(untouched));
+    }
+
+    if (!sweeps_in_lanes(field)) {
+      // a render of their own each
+      for (auto& lane : fields) {
+        if (options.token.cancelled()) break;
+        lane.render_with_callback(nullptr, options);
+      }
+    } else if (!fields.empty()) {
+      with_integrator(field.parms.integrator, [&](auto integrator) {
+        using Integrator = decltype(integrator);
+        const auto& parms = field.parms;
+        with_force_law(parms.force_law, parms.softening, parms.force_exponent,
+                       [&](const auto& law) {
+                         sweep_bricks<Integrator>(field, layout, fields, law,
+                                                  options);
+                       });
+      });
+    }
+    return options.token.cancelled() ? RenderStatus::cancelled
+                                     : RenderStatus::completed;
+  }
+}  // namespace mgs
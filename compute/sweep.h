@@ -0,0 +1,276 @@
+#pragma once
+
+/**
+ * Parameter sweeps: one star geometry rendered under many values of
+ * the gravitational constant, delta_t or the star masses at once.
+ *
+ * Rather than one render per parameter set, going over the same
+ * cells and working out the same starting positions each time, the
+ * sweep takes each cell once and integrates its FPM under every
+ * parameter set, sweep_lanes orbits side by side, one to a lane: the
+ * positions, velocities and steps of the lanes are kept as arrays
+ * (Lanes, LaneVec3), and every operation on them is the same one
+ * over each lane in turn, which the compiler turns into vector
+ * instructions. The lanes share the star positions, the integrator
+ * and the force law, so LaneStarKernel loads each star once for all
+ * of them. The integrators of integrators.h step lanes as they do
+ * single FPMs.
+ *
+ * A lane whose orbit is over takes the next at once, the same cell
+ * under the next parameter set or the next cell, so the lanes stay
+ * busy however different their counts. Each lane does exactly what
+ * a render of its own does, in the same order, so the counts match
+ * bit for bit.
+ *
+ * Fields needing anything a lane cannot do (adaptive steps, the
+ * Kepler fast forward, a star tree or acceleration grid, channels)
+ * are swept by a render per parameter set instead; see
+ * sweeps_in_lanes().
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs {
+  // parameter sets integrated side by side
+  const std::size_t sweep_lanes = 8;
+
+  template <typename T, std::size_t W>
+  struct Lanes {
+    std::array<T, W> v{};
+
+    Lanes() = default;
+    Lanes(T s) { v.fill(s); }  // the same in every lane
+
+    T& operator[](std::size_t l) { return v[l]; }
+    T operator[](std::size_t l) const { return v[l]; }
+
+    friend Lanes operator+(const Lanes& a, const Lanes& b) {
+      return lanewise(a, b, [](T x, T y) { return x + y; });
+    }
+    friend Lanes operator-(const Lanes& a, const Lanes& b) {
+      return lanewise(a, b, [](T x, T y) { return x - y; });
+    }
+    friend Lanes operator*(const Lanes& a, const Lanes& b) {
+      return lanewise(a, b, [](T x, T y) { return x * y; });
+    }
+    friend Lanes operator/(const Lanes& a, const Lanes& b) {
+      return lanewise(a, b, [](T x, T y) { return x / y; });
+    }
+
+    friend Lanes operator-(const Lanes& a) {
+      Lanes r;
+      for (std::size_t l = 0; l < W; ++l) r.v[l] = -a.v[l];
+      return r;
+    }
+    // for the Yoshida coefficients
+    friend Lanes cbrt(const Lanes& a) {
+      Lanes r;
+      for (std::size_t l = 0; l < W; ++l) r.v[l] = std::cbrt(a.v[l]);
+      return r;
+    }
+
+   private:
+    template <typename F>
+    static Lanes lanewise(const Lanes& a, const Lanes& b, F f) {
+      Lanes r;
+      for (std::size_t l = 0; l < W; ++l) r.v[l] = f(a.v[l], b.v[l]);
+      return r;
+    }
+  };
+
+  template <typename T, std::size_t W>
+  struct LaneVec3 {
+    using lanes_type = Lanes<T, W>;
+    lanes_type x, y, z;
+
+    LaneVec3() = default;
+    explicit LaneVec3(const Vec3<T>& p) : x(p.x), y(p.y), z(p.z) {}
+
+    friend LaneVec3 operator+(const LaneVec3& a, const LaneVec3& b) {
+      return {a.x + b.x, a.y + b.y, a.z + b.z};
+    }
+    friend LaneVec3 operator-(const LaneVec3& a, const LaneVec3& b) {
+      return {a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+    friend LaneVec3 operator*(const LaneVec3& a, const lanes_type& s) {
+      return {a.x * s, a.y * s, a.z * s};
+    }
+    LaneVec3& operator+=(const LaneVec3& o) {
+      x = x + o.x;
+      y = y + o.y;
+      z = z + o.z;
+      return *this;
+    }
+    LaneVec3& operator-=(const LaneVec3& o) {
+      x = x - o.x;
+      y = y - o.y;
+      z = z - o.z;
+      return *this;
+    }
+
+   private:
+    LaneVec3(const lanes_type& x_, const lanes_type& y_,
+             const lanes_type& z_)
+        : x(x_), y(y_), z(z_) {}
+  };
+
+  /**
+   * The pull of the stars, as star_acceleration() sums it for each
+   * star in turn, on every lane, each with its own -G·m per star.
+   */
+  template <typename T, std::size_t W, typename Law>
+  struct LaneStarKernel {
+    using vector_type = LaneVec3<T, W>;
+
+    std::vector<T> sx, sy, sz, capture_squared;
+    std::vector<Lanes<T, W>> neg_gm;  // by star, then lane
+    Law law;
+    bool has_capture = false;
+
+    LaneStarKernel(const std::vector<Star>& stars, const Law& l,
+                   const T default_capture_radius)
+        : neg_gm(stars.size()), law(l) {
+      for (const auto& star : stars) {
+        sx.push_back(star.position[0]);
+        sy.push_back(star.position[1]);
+        sz.push_back(star.position[2]);
+        T radius = capture_radius_of(star, default_capture_radius);
+        capture_squared.push_back(radius * radius);
+        has_capture |= radius > 0;
+      }
+    }
+
+    // the lane's -G·m, one per star
+    void load(std::size_t l, const T* lane_neg_gm) {
+      for (std::size_t i = 0; i < neg_gm.size(); ++i)
+        neg_gm[i][l] = lane_neg_gm[i];
+    }
+
+    inline vector_type operator()(const vector_type& p) const {
+      vector_type a;
+      const std::size_t n = neg_gm.size();
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t l = 0; l < W; ++l) {
+          const T x = p.x[l] - sx[i];
+          const T y = p.y[l] - sy[i];
+          const T z = p.z[l] - sz[i];
+          const T k = neg_gm[i][l] * law.scale(x * x + y * y + z * z);
+          a.x[l] += x * k;
+          a.y[l] += y * k;
+          a.z[l] += z * k;
+        }
+      }
+      return a;
+    }
+
+    inline bool captured(const vector_type& p, std::size_t l) const {
+      for (std::size_t i = 0; i < capture_squared.size(); ++i) {
+        const Vec3<T> d{p.x[l] - sx[i], p.y[l] - sy[i], p.z[l] - sz[i]};
+        if (d.norm_squared() < capture_squared[i]) return true;
+      }
+      return false;
+    }
+  };
+
+  // an orbit for a lane: where it starts, at rest, and under what
+  template <typename T>
+  struct LaneOrbit {
+    Vec3<T> p;
+    Vec3<T> center;  // of star mass
+    T delta_t;
+    const T* neg_gm;  // -G·m, one per star
+  };
+
+  /**
+   * integrate_cell() for a stream of orbits, W at a time, without the
+   * Kepler fast forward. next(l, orbit) is asked for the orbit to give
+   * lane l each time it comes free, returning false once there are
+   * none left, and done(l, count) told the count of the orbit it had.
+   * Lanes with nothing left to do step on with the others, to no
+   * effect, until all are done.
+   */
+  template <typename T, typename I, typename Integrator, std::size_t W,
+            typename Law, typename Next, typename Done>
+  inline void integrate_lanes(LaneStarKernel<T, W, Law>& kernel,
+                              const I iter_limit, const T escape_radius,
+                              Next&& next, Done&& done) {
+    LaneVec3<T, W> p, v, center;
+    Lanes<T, W> delta_t, r;
+    std::array<I, W> iter{};
+    std::array<bool, W> busy{};
+
+    // the lane's next orbit, if any, and how far out it starts
+    auto take = [&](std::size_t l) {
+      LaneOrbit<T> orbit;
+      busy[l] = next(l, orbit);
+      if (!busy[l]) return T(0);
+      p.x[l] = orbit.p.x;
+      p.y[l] = orbit.p.y;
+      p.z[l] = orbit.p.z;
+      v.x[l] = v.y[l] = v.z[l] = 0;
+      center.x[l] = orbit.center.x;
+      center.y[l] = orbit.center.y;
+      center.z[l] = orbit.center.z;
+      delta_t[l] = orbit.delta_t;
+      kernel.load(l, orbit.neg_gm);
+      iter[l] = 0;
+      return (orbit.p - orbit.center).norm();
+    };
+    // before the lane's next step: over, and on to the next orbit?
+    auto settle = [&](std::size_t l, T r) {
+      while (busy[l]) {
+        I count = -1;
+        if (r > escape_radius || iter[l] >= iter_limit)
+          count = iter[l];
+        else if (kernel.has_capture && kernel.captured(p, l))
+          count = iter_limit;
+        if (count < 0) return;
+        done(l, count);
+        r = take(l);
+      }
+    };
+
+    for (std::size_t l = 0; l < W; ++l) settle(l, take(l));
+    while (std::find(busy.begin(), busy.end(), true) != busy.end()) {
+      Integrator::step(p, v, delta_t, kernel);
+      const auto d = p - center;
+      for (std::size_t l = 0; l < W; ++l) {
+        ++iter[l];
+        r[l] = std::sqrt(d.x[l] * d.x[l] + d.y[l] * d.y[l] + d.z[l] * d.z[l]);
+      }
+      for (std::size_t l = 0; l < W; ++l) settle(l, r[l]);
+    }
+  }
+
+  // what a sweep may change from one parameter set to the next
+  struct SweepPoint {
+    floating_t gravitational_constant;
+    floating_t delta_t;
+    // one per star; empty keeps the field's masses, any other count
+    // and the sweep is refused
+    std::vector<floating_t> star_masses;
+  };
+
+  // whether render_sweep() can take the field's cells in lanes
+  bool sweeps_in_lanes(const StarField& field);
+
+  /**
+   * Renders the field under each of the points, into fields, one per
+   * point: a copy of the field with the point's constant, step and
+   * masses, and its grid. Options as for a render, though the cache
+   * only serves sweeps rendered a parameter set at a time; cancelling
+   * through options.token stops it where it is. A point with masses
+   * for other than every star renders nothing: fields is left empty
+   * and the sweep returns cancelled.
+   */
+  RenderStatus render_sweep(const StarField& field,
+                            const std::vector<SweepPoint>& points,
+                            std::vector<StarField>& fields,
+                            const RenderOptions& options = {});
+}  // namespace mgs
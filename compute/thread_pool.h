@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * A persistent pool of worker threads, for renders that come too
+ * thick and fast to start threads of their own each time (see
+ * daemon.h). Handed to a render through RenderOptions::pool, its
+ * threads do the render's passes over the bricks.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mgs {
+  class ThreadPool {
+   public:
+    // 0 means one per hardware thread, the caller's included
+    explicit ThreadPool(unsigned threads = 0) {
+      if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+      for (unsigned t = 1; t < threads; ++t)
+        m_threads.emplace_back([this, t] { serve(t); });
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+      }
+      m_wake.notify_all();
+      for (auto& th : m_threads) th.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // the most workers a run can have
+    unsigned size() const {
+      return static_cast<unsigned>(m_threads.size()) + 1;
+    }
+
+    /**
+     * Runs fn(w) for each w below workers (at most size()), 0 on the
+     * calling thread and the rest on the pool's, and waits for them
+     * all. One run at a time; not to be called from within a run.
+     */
+    void run(unsigned workers, const std::function<void(unsigned)>& fn) {
+      std::lock_guard<std::mutex> one_at_a_time(m_run);
+      workers = std::clamp(workers, 1u, size());
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_task = &fn;
+        m_workers = workers;
+        m_pending = workers - 1;
+        ++m_generation;
+      }
+      m_wake.notify_all();
+      fn(0);
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_done.wait(lock, [&] { return m_pending == 0; });
+      m_task = nullptr;
+    }
+
+   private:
+    std::mutex m_run;
+    std::mutex m_lock;
+    std::condition_variable m_wake, m_done;
+    const std::function<void(unsigned)>* m_task = nullptr;
+    std::uint64_t m_generation = 0;
+    unsigned m_workers = 0;
+    unsigned m_pending = 0;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+
+    void serve(unsigned w) {
+      std::uint64_t seen = 0;
+      std::unique_lock<std::mutex> lock(m_lock);
+      for (;;) {
+        m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if (m_stop) return;
+        seen = m_generation;
+        if (w >= m_workers) continue;
+        auto* task = m_task;
+        lock.unlock();
+        (*task)(w);
+        lock.lock();
+        if (--m_pending == 0) m_done.notify_one();
+      }
+    }
+  };
+}  // namespace mgs
@@ -0,0 +1,407 @@
+#pragma once
+
+/**
+ * The basic MGS types: indices, vectors, stars, and the field
+ * parameters, along with the Newtonian acceleration kernel.
+ * Split out of compute.h so that the pieces compute.h builds on
+ * can use them too.
+ */
+
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "force_laws.h"
+#include "integrators.h"
+
+namespace mgs {
+  const int default_dimension = 3;
+  const int untouched = -1;
+
+  using indexer_t = std::int32_t;
+  using iterant_t = std::int16_t;
+  using idx_vector_t = std::vector<indexer_t>;
+  using floating_t = double;
+
+  // which star captured an FPM, if any (see Star::capture_radius)
+  using star_index_t = std::int16_t;
+  const star_index_t not_captured = -1;
+
+  /**
+   * How an FPM's orbit ended, beyond its iteration count. The escape
+   * time is the iteration count made fractional: where within the
+   * last step the FPM crossed escape_radius, interpolated from its
+   * distance to the center either side of the crossing. It is the
+   * iteration limit for an FPM that never escaped.
+   *
+   * For an FPM reaching the limit, reached is the iteration its
+   * final state (as last observed) is at: the limit, unless a Kepler
+   * leg would have overrun it. See resume.h.
+   */
+  template <typename T>
+  struct CellOutcome {
+    star_index_t captured_by = not_captured;
+    T escape_time = 0;
+    std::int64_t reached = 0;
+  };
+
+  /**
+   * index_bits_t will increment the index according
+   * to the bits set. This is primarilary for the
+   * marching tetrahedra algorithm.
+   */
+  using index_bits_t = std::bitset<3>;
+
+  struct Index {
+    idx_vector_t ijk;
+
+    Index(std::initializer_list<indexer_t> list) : ijk(list) {}
+    explicit Index(idx_vector_t v) : ijk(std::move(v)) {}
+    Index(const Index& other) : ijk(other.ijk) {}
+    Index(const Index&& other) : ijk(std::move(other.ijk)) {}
+
+    bool operator==(const Index& other) const {
+      return ijk == other.ijk;
+    }
+    
+    Index& operator=(const Index& other) {
+      ijk = other.ijk;
+      return *this;
+    }
+
+    Index& operator=(Index&& other) {
+      ijk = std::move(other.ijk);
+      return *this;
+    }
+
+    auto& operator[](const indexer_t& i) { return ijk[i]; }
+    auto operator[](const indexer_t& i) const { return ijk[i]; }
+    auto size() const { return ijk.size(); }
+  };
+
+  /**
+   * For 3D MGS only, primarily for marching tetrahedra.
+   */
+  inline Index operator+(const Index& source, const index_bits_t& bits) {
+    Index dest = source;
+    for (decltype(bits.size()) i{}; i < bits.size(); ++i) {
+      dest.ijk[i] += static_cast<indexer_t>(bits[i]);
+    }
+    return dest;
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, Index const& idx) {
+    os << "Index[ ";
+    for (auto i : idx.ijk) {
+      os << i << " ";
+    }
+    os << "]";
+    return os;
+  }
+
+  // The P here is a phantom parameter to enable strong typing.
+  // It is not actually used anywhere directly.
+  template <typename T, typename Indexer, typename P>
+  struct Vector {
+    std::vector<T> vec;
+
+    Vector(Indexer dimension = default_dimension) {
+      vec.resize(dimension, 0.0);
+    }
+    Vector(std::initializer_list<T> list) : vec(list) {}
+
+    Vector(const Vector& other) : vec(other.vec) {}
+    Vector(const Vector&& other) : vec(std::move(other.vec)) {}
+
+    Vector& operator=(const Vector& other) {
+      vec = other.vec;
+      return *this;
+    }
+
+    inline T& operator[](Indexer index) { return vec[index]; }
+    inline T operator[](Indexer index) const { return vec[index]; }
+
+    inline auto size() { return static_cast<Indexer>(vec.size()); }
+
+    inline Vector& operator=(Vector&& other) {
+      vec = std::move(other.vec);
+      return *this;
+    }
+
+    inline T norm() const {
+      T nr = 0.0;
+      for (auto v : vec) {
+        nr += v * v;
+      }
+      return T(sqrt(nr));
+    }
+
+    inline T norm_squared() const {
+      T nr = 0.0;
+      for (auto v : vec) {
+        nr += v * v;
+      }
+      return nr;
+    }
+
+    inline Vector unit_vector() const { return *this / this->norm(); }
+
+    // Danger: behavior of vectors of unequal lengths is undefined.
+    inline T dot(const Vector& vo) const {
+      auto a = this->vec.cbegin();
+      auto b = vo.vec.cbegin();
+      T sum = 0;
+      for (; a != this->vec.cend(); ++a, ++b) sum += (*a) * (*b);
+      return sum;
+    }
+
+    // u x v, this being u, using Sarrus's Rule
+    // only valid for 3-vectors, no checks done.
+    // {u[2]v[3]-u[3]v[2], u[3]v[1]-u[1]v[3], u[1]v[2]-u[2]v[1]}
+    // indices adjusted for zero-based vectors in the code!!!!
+    inline Vector cross(const Vector& vo) const {
+      const auto& u = this->vec;
+      const auto& v = vo.vec;
+      return Vector{u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+                    u[0] * v[1] - u[1] * v[0]};
+    }
+
+    inline Vector operator+(const Vector& other) const {
+      Vector result(vec.size());
+      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
+        result.vec[i] = vec[i] + other.vec[i];
+      }
+      return result;
+    }
+
+    inline Vector operator+=(const Vector& other) {
+      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
+        vec[i] += other.vec[i];
+      }
+      return *this;
+    }
+
+    inline Vector operator-(const Vector& other) const {
+      Vector result(vec.size());
+      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
+        result.vec[i] = vec[i] - other.vec[i];
+      }
+      return result;
+    }
+
+    inline Vector operator*(const floating_t scalar) const {
+      Vector result(vec.size());
+      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
+        result.vec[i] = vec[i] * scalar;
+      }
+      return result;
+    }
+
+    inline Vector operator/(const floating_t scalar) const {
+      Vector result(vec.size());
+      for (Indexer i = 0; i < static_cast<Indexer>(vec.size()); ++i) {
+        result.vec[i] = vec[i] / scalar;
+      }
+      return result;
+    }
+
+    /**
+     * TODO: Note that this may not make sense for floats. We'll
+     * TODO: have to add an epsillon here eventually... this is
+     * TODO: mostly for testing.
+     */
+    inline bool operator==(const Vector& other) const {
+      return vec == other.vec;
+    }
+  };
+
+  // Specifically defined types for our model.
+  // TODO: Tighten up type safety here. Currently everything is defined as
+  // "MathParam".
+  using Coordinate = Vector<floating_t, indexer_t, struct MathParm>;
+  using Position = Vector<floating_t, indexer_t, struct MathParm>;
+  using Velocity = Vector<floating_t, indexer_t, struct MathParm>;
+  using Acceleration = Vector<floating_t, indexer_t, struct MathParm>;
+  using Vec =
+      Vector<floating_t, indexer_t, struct MathParm>;  // generalized vector
+
+  /**
+   * For some operations, it helps to have Position and Velocity
+   * combined.
+   */
+  struct PosVel {
+    Position p;
+    Velocity v;
+  };
+
+  /**
+   * A bounding box for the field
+   */
+  struct Bounds {
+    Coordinate nm;  // Negative-most coordinate
+    Coordinate pm;  // Positive-most coordinate
+    Bounds() = default;
+  };
+
+  template <typename T, typename I, typename P>
+  inline std::ostream& operator<<(std::ostream& os, Vector<T, I, P> const& c) {
+    os << "Vector[ ";
+    for (auto v : c.vec) {
+      os << v << " ";
+    }
+    os << "]";
+    return os;
+  }
+
+  struct Star {
+    floating_t mass;
+    Position position;
+    // an FPM coming closer than this is captured by the star, and
+    // iterated no further; 0 for FieldParms::capture_radius
+    floating_t capture_radius = 0;
+
+    Star(floating_t m, Position pos, floating_t capture = 0)
+        : mass(m), position(pos), capture_radius(capture) {}
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, Star const& star) {
+    os << "Star[";
+    os << " mass:" << star.mass;
+    os << " position:" << star.position;
+    if (star.capture_radius > 0) os << " capture_radius:" << star.capture_radius;
+    os << " ]";
+    return os;
+  }
+
+  /**
+   * The capture radius of the star, given the default for stars
+   * that have none of their own.
+   */
+  template <typename T>
+  inline T capture_radius_of(const Star& star, const T default_radius) {
+    return star.capture_radius > 0 ? T(star.capture_radius) : default_radius;
+  }
+
+  /* Computes the acceleration of a single star on
+   * the fpm, the Free Point Mass, under the given force law.
+   */
+  template <typename T, typename I, typename Law = Newtonian<T>>
+  inline Acceleration compute_acceleration(const Star& star,
+                                           const Position& fpm,
+                                           const T gravitational_constant,
+                                           const Law& law = Law{}) {
+    auto r_vec = fpm - star.position;
+    auto neg_gm = (-gravitational_constant) * star.mass;
+    return r_vec * (neg_gm * law.scale(r_vec.norm_squared()));
+  }
+
+  /**
+   * The acceleration on the fpm due to all the stars. This is
+   * the kernel every integrator evaluates.
+   */
+  template <typename T, typename I, typename Law = Newtonian<T>>
+  inline Acceleration total_acceleration(const std::vector<Star>& stars,
+                                         const Position& fpm,
+                                         const T gravitational_constant,
+                                         const Law& law = Law{}) {
+    Acceleration a;
+    for (const auto& star : stars) {
+      a += compute_acceleration<T, I>(star, fpm, gravitational_constant, law);
+    }
+    return a;
+  }
+
+  // see accel_grid.h
+  enum class AccelInterpolation { trilinear, tricubic };
+
+  /**
+   * Field Parameters for MGS. These determine the nature
+   * of the MGS fractal that is generated.
+   */
+  template <typename T, typename Interant>
+  struct FieldParms {
+    T gravitational_constant;
+    T delta_t;
+    Interant iter_limit;
+    T escape_radius;
+    IntegratorKind integrator = IntegratorKind::euler;
+
+    // Adaptive stepping (see adaptive.h): delta_t becomes the nominal
+    // step, and iterations are counted in units of it.
+    bool adaptive = false;
+    T adaptive_eta = 0.05;
+
+    // Tolerance on the point mass approximation of the cluster
+    // beyond which outbound legs are fast forwarded analytically
+    // (see kepler.h). 0 disables the fast forward.
+    T kepler_tolerance = 0;
+
+    // The force law (see force_laws.h), its softening length and,
+    // for the power law, the exponent n of the 1 / r^n force.
+    ForceLawKind force_law = ForceLawKind::newtonian;
+    T softening = 0;
+    T force_exponent = 2;
+
+    // Opening angle for the Barnes-Hut tree (see octree.h). 0 sums
+    // over the stars directly.
+    T opening_angle = 0;
+
+    // Precomputed acceleration table (see accel_grid.h): the number
+    // of nodes along each axis of the render bounds, 0 for none, and
+    // the radius about each star within which the exact kernel is
+    // used regardless.
+    int accel_grid_size = 0;
+    AccelInterpolation accel_interpolation = AccelInterpolation::trilinear;
+    T accel_guard_radius = 0.25;
+
+    // Capture radius for the stars that have none of their own
+    // (Star::capture_radius); 0 for no capture.
+    T capture_radius = 0;
+
+    FieldParms() = default;
+    FieldParms(T gc, T dt, Interant il, T er,
+               IntegratorKind integ = IntegratorKind::euler)
+        : gravitational_constant(gc),
+          delta_t(dt),
+          iter_limit(il),
+          escape_radius(er),
+          integrator(integ) {}
+
+    // the same parameters counted in another iterant type
+    template <typename OtherInterant>
+    explicit FieldParms(const FieldParms<T, OtherInterant>& other)
+        : FieldParms(other.gravitational_constant, other.delta_t,
+                     static_cast<Interant>(other.iter_limit),
+                     other.escape_radius, other.integrator) {
+      adaptive = other.adaptive;
+      adaptive_eta = other.adaptive_eta;
+      kepler_tolerance = other.kepler_tolerance;
+      force_law = other.force_law;
+      softening = other.softening;
+      force_exponent = other.force_exponent;
+      opening_angle = other.opening_angle;
+      accel_grid_size = other.accel_grid_size;
+      accel_interpolation = other.accel_interpolation;
+      accel_guard_radius = other.accel_guard_radius;
+      capture_radius = other.capture_radius;
+    }
+  };
+
+  /**
+   */
+  template <typename T, typename I>
+  Position compute_center_of_star_mass(const std::vector<Star>& stars) {
+    T total_star_mass = 0.0;
+    Position center_accum;
+
+    for (auto star : stars) {
+      total_star_mass += star.mass;
+      center_accum += star.position * star.mass;
+    }
+    return center_accum / total_star_mass;
+  }
+}  // namespace mgs
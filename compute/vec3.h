@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * A fixed size 3-vector for the inner loops. Vector keeps its
+ * components on the heap so that it can be of any dimension, which
+ * costs an allocation for every temporary; Vec3 lives entirely in
+ * registers. It offers the same interface as Vector, so that the
+ * integrators and the Kepler fast forward work with either.
+ */
+
+#include <cmath>
+
+#include "types.h"
+
+namespace mgs {
+  template <typename T>
+  struct Vec3 {
+    T x = 0, y = 0, z = 0;
+
+    Vec3() = default;
+    Vec3(T x_, T y_, T z_) : x(x_), y(y_), z(z_) {}
+    explicit Vec3(const Position& p) : x(p[0]), y(p[1]), z(p[2]) {}
+
+    Position position() const { return Position{x, y, z}; }
+
+    inline T& operator[](indexer_t i) { return i == 0 ? x : i == 1 ? y : z; }
+    inline T operator[](indexer_t i) const {
+      return i == 0 ? x : i == 1 ? y : z;
+    }
+    inline indexer_t size() const { return 3; }
+
+    inline T norm_squared() const { return x * x + y * y + z * z; }
+    inline T norm() const { return std::sqrt(norm_squared()); }
+    inline Vec3 unit_vector() const { return *this / norm(); }
+    inline T dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+    inline Vec3 cross(const Vec3& o) const {
+      return Vec3{y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+    }
+
+    inline Vec3 operator+(const Vec3& o) const {
+      return Vec3{x + o.x, y + o.y, z + o.z};
+    }
+    inline Vec3 operator-(const Vec3& o) const {
+      return Vec3{x - o.x, y - o.y, z - o.z};
+    }
+    inline Vec3 operator*(const T s) const { return Vec3{x * s, y * s, z * s}; }
+    inline Vec3 operator/(const T s) const { return Vec3{x / s, y / s, z / s}; }
+    inline Vec3& operator+=(const Vec3& o) {
+      x += o.x;
+      y += o.y;
+      z += o.z;
+      return *this;
+    }
+    inline Vec3& operator-=(const Vec3& o) {
+      x -= o.x;
+      y -= o.y;
+      z -= o.z;
+      return *this;
+    }
+    inline bool operator==(const Vec3& o) const {
+      return x == o.x && y == o.y && z == o.z;
+    }
+  };
+
+  template <typename T>
+  inline std::ostream& operator<<(std::ostream& os, Vec3<T> const& v) {
+    os << "Vec3[ " << v.x << " " << v.y << " " << v.z << " ]";
+    return os;
+  }
+}  // namespace mgs
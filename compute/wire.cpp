@@ -0,0 +1,311 @@
+#include <wire.h>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+
+namespace mgs::wire {
+  namespace {
+    template <typename Archive, typename Parms>
+    void transfer_parms(Archive& a, Parms& parms) {
+      a.io(parms.gravitational_constant);
+      a.io(parms.delta_t);
+      a.io(parms.iter_limit);
+      a.io(parms.escape_radius);
+      a.io(parms.integrator);
+      a.io(parms.adaptive);
+      a.io(parms.adaptive_eta);
+      a.io(parms.kepler_tolerance);
+      a.io(parms.force_law);
+      a.io(parms.softening);
+      a.io(parms.force_exponent);
+      a.io(parms.opening_angle);
+      a.io(parms.accel_grid_size);
+      a.io(parms.accel_interpolation);
+      a.io(parms.accel_guard_radius);
+      a.io(parms.capture_radius);
+    }
+
+    template <typename Archive>
+    void transfer_vector(Archive& a, Vec& v) {
+      std::uint32_t n = static_cast<std::uint32_t>(v.vec.size());
+      a.io(n);
+      if (v.vec.size() != n) v.vec.assign(std::min<std::uint32_t>(n, 3), 0);
+      for (auto& x : v.vec) a.io(x);
+    }
+
+    struct Endpoint {
+      bool unix_socket = false;
+      std::string path;  // or host
+      std::string port;
+    };
+
+    bool parse_endpoint(const std::string& text, Endpoint& endpoint) {
+      if (text.rfind("unix:", 0) == 0) {
+        endpoint.unix_socket = true;
+        endpoint.path = text.substr(5);
+        return !endpoint.path.empty() &&
+               endpoint.path.size() < sizeof(sockaddr_un::sun_path);
+      }
+      if (text.rfind("tcp:", 0) == 0) {
+        auto colon = text.rfind(':');
+        if (colon <= 4) return false;
+        endpoint.path = text.substr(4, colon - 4);
+        endpoint.port = text.substr(colon + 1);
+        return !endpoint.port.empty();
+      }
+      return false;
+    }
+
+    sockaddr_un unix_address(const std::string& path) {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, path.c_str(),
+                   sizeof address.sun_path - 1);
+      return address;
+    }
+
+    // the TCP socket, bound (listening) or connected, or -1
+    int tcp_socket(const Endpoint& endpoint, bool listening) {
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = listening ? AI_PASSIVE : 0;
+      addrinfo* found = nullptr;
+      if (::getaddrinfo(endpoint.path.c_str(), endpoint.port.c_str(), &hints,
+                        &found) != 0)
+        return -1;
+      int fd = -1;
+      for (auto* a = found; a && fd < 0; a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC,
+                      a->ai_protocol);
+        if (fd < 0) continue;
+        int on = 1;
+        if (listening)
+          ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+        bool ok = listening ? ::bind(fd, a->ai_addr, a->ai_addrlen) == 0
+                            : ::connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+        if (!ok) {
+          ::close(fd);
+          fd = -1;
+        }
+      }
+      ::freeaddrinfo(found);
+      return fd;
+    }
+  }  // namespace
+
+  std::vector<std::uint8_t> Writer::frame(MessageKind kind) const {
+    FrameHeader header{kind, 0, m_bytes.size()};
+    std::vector<std::uint8_t> out(sizeof header + m_bytes.size());
+    std::memcpy(out.data(), &header, sizeof header);
+    std::copy(m_bytes.begin(), m_bytes.end(), out.begin() + sizeof header);
+    return out;
+  }
+
+  void write_field(Writer& w, const StarField& field) {
+    w.io(kernel_version);
+    w.io(field.cube_size);
+    w.io(field.dimension);
+    auto box = field.box;
+    transfer_vector(w, box.nm);
+    transfer_vector(w, box.pm);
+    auto parms = field.parms;
+    transfer_parms(w, parms);
+    w.io(static_cast<std::uint32_t>(field.stars.size()));
+    for (auto star : field.stars) {
+      w.io(star.mass);
+      w.io(star.capture_radius);
+      transfer_vector(w, star.position);
+    }
+    w.io(static_cast<std::uint32_t>(field.channels.size()));
+    for (const auto& channel : field.channels) {
+      auto range = channel.range();
+      w.io(channel.kind());
+      w.io(channel.storage());
+      w.io(range.lo);
+      w.io(range.hi);
+    }
+  }
+
+  bool read_field(Reader& r, StarField& field) {
+    std::uint32_t version = 0;
+    indexer_t cube_size = 0, dimension = 0;
+    Bounds box;
+    r.io(version);
+    r.io(cube_size);
+    r.io(dimension);
+    transfer_vector(r, box.nm);
+    transfer_vector(r, box.pm);
+    if (!r.good() || version != kernel_version || cube_size < 1 ||
+        dimension < 1 || dimension > 3)
+      return false;
+
+    field.box = box;
+    field.cube_size = cube_size;
+    field.dimension = dimension;
+    // within the capacity it already has, if it will do
+    field.grid.assign(std::pow(cube_size, dimension), untouched);
+    transfer_parms(r, field.parms);
+    std::uint32_t stars = 0;
+    r.io(stars);
+    field.stars.clear();
+    for (std::uint32_t s = 0; r.good() && s < stars; ++s) {
+      Star star(0, Position{});
+      r.io(star.mass);
+      r.io(star.capture_radius);
+      transfer_vector(r, star.position);
+      field.stars.push_back(star);
+    }
+    std::uint32_t channels = 0;
+    r.io(channels);
+    field.channels = ChannelSet();
+    for (std::uint32_t c = 0; r.good() && c < channels; ++c) {
+      ChannelKind kind{};
+      ChannelStorage storage{};
+      ChannelRange range;
+      r.io(kind);
+      r.io(storage);
+      r.io(range.lo);
+      r.io(range.hi);
+      if (r.good()) field.channels.request(kind, storage, range);
+    }
+    return r.good();
+  }
+
+  void write_results(Writer& w, const StarField& field) {
+    w.io(static_cast<std::uint64_t>(field.grid.size()));
+    w.io(reinterpret_cast<const std::uint8_t*>(field.grid.data()),
+         field.grid.size() * sizeof(iterant_t));
+    w.io(static_cast<std::uint32_t>(field.channels.size()));
+    for (const auto& channel : field.channels) {
+      w.io(channel.kind());
+      w.io(static_cast<std::uint64_t>(channel.bytes()));
+      w.io(channel.data(), channel.bytes());
+    }
+  }
+
+  bool read_results(Reader& r, StarField& field) {
+    std::uint64_t cells = 0;
+    r.io(cells);
+    if (!r.good() || r.left() < cells * sizeof(iterant_t)) return false;
+    field.grid.resize(cells);
+    r.io(reinterpret_cast<std::uint8_t*>(field.grid.data()),
+         cells * sizeof(iterant_t));
+    std::uint32_t channels = 0;
+    r.io(channels);
+    for (std::uint32_t c = 0; r.good() && c < channels; ++c) {
+      ChannelKind kind{};
+      std::uint64_t bytes = 0;
+      r.io(kind);
+      r.io(bytes);
+      if (!r.good() || r.left() < bytes) return false;
+      auto* channel = field.channels.find(kind);
+      if (!channel) channel = &field.channels.request(kind);
+      channel->assign(r.rest(), bytes);
+      r.skip(bytes);
+    }
+    return r.good();
+  }
+
+  bool send_all(int fd, const std::vector<std::uint8_t>& bytes) {
+    std::size_t sent = 0;
+    while (sent < bytes.size()) {
+      auto n = ::send(fd, bytes.data() + sent, bytes.size() - sent,
+                      MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      sent += n;
+    }
+    return true;
+  }
+
+  bool receive_all(int fd, std::uint8_t* bytes, std::size_t size) {
+    std::size_t got = 0;
+    while (got < size) {
+      auto n = ::recv(fd, bytes + got, size - got, 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      got += n;
+    }
+    return true;
+  }
+
+  bool receive_frame(int fd, FrameHeader& header,
+                     std::vector<std::uint8_t>& body) {
+    if (!receive_all(fd, reinterpret_cast<std::uint8_t*>(&header),
+                     sizeof header))
+      return false;
+    body.resize(header.size);
+    return receive_all(fd, body.data(), body.size());
+  }
+
+  int listen_on(const std::string& endpoint, std::string& resolved,
+                std::string& unix_path) {
+    Endpoint parsed;
+    if (!parse_endpoint(endpoint, parsed)) return -1;
+    int fd = -1;
+    if (parsed.unix_socket) {
+      fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      auto address = unix_address(parsed.path);
+      ::unlink(parsed.path.c_str());
+      if (fd >= 0 && ::bind(fd, reinterpret_cast<sockaddr*>(&address),
+                            sizeof address) != 0) {
+        ::close(fd);
+        fd = -1;
+      }
+      if (fd >= 0) unix_path = parsed.path;
+      resolved = endpoint;
+    } else {
+      fd = tcp_socket(parsed, true);
+      sockaddr_storage bound{};
+      socklen_t length = sizeof bound;
+      if (fd >= 0 &&
+          ::getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) ==
+              0) {
+        auto port = bound.ss_family == AF_INET6
+                        ? reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port
+                        : reinterpret_cast<sockaddr_in*>(&bound)->sin_port;
+        resolved = "tcp:" + parsed.path + ":" + std::to_string(ntohs(port));
+      }
+    }
+    if (fd >= 0 && (::listen(fd, SOMAXCONN) != 0 ||
+                    ::fcntl(fd, F_SETFL, O_NONBLOCK) != 0)) {
+      ::close(fd);
+      fd = -1;
+    }
+    return fd;
+  }
+
+  int connect_to(const std::string& endpoint) {
+    Endpoint parsed;
+    if (!parse_endpoint(endpoint, parsed)) return -1;
+    if (!parsed.unix_socket) return tcp_socket(parsed, false);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    auto address = unix_address(parsed.path);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                             sizeof address) != 0) {
+      ::close(fd);
+      fd = -1;
+    }
+    return fd;
+  }
+
+  int accept_from(int listener) {
+    int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) {
+      int on = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    return fd;
+  }
+}  // namespace mgs::wire
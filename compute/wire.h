@@ -0,0 +1,166 @@
+#pragma once
+
+/**
+ * What the processes of a render say to one another over sockets
+ * (see distributed.h and daemon.h): framed messages, each a header
+ * giving its kind and size and then the values of the message one
+ * after another, in the byte order of the machine.
+ *
+ * Writer and Reader share the same io() calls, so a message whose
+ * values are named once, in a transfer function over either, reads
+ * back as it was written.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "compute.h"
+
+namespace mgs::wire {
+  enum class MessageKind : std::uint32_t {
+    job = 1,      // coordinator to worker: the field to render
+    brick = 2,    // coordinator to worker: a brick of it to render
+    result = 3,   // worker to coordinator: the brick's counts
+    request = 4,  // client to daemon: a field to render
+    reply = 5,    // daemon to client: how it went, and maybe the field
+  };
+
+  // the size is 64 bits wide: a reply carrying a large field's
+  // results can run past 4 GiB
+  struct FrameHeader {
+    MessageKind kind;
+    std::uint32_t reserved;  // zero; keeps size aligned, and sent
+    std::uint64_t size;      // of what follows
+  };
+
+  class Writer {
+   public:
+    template <typename V>
+    void io(const V& value) {
+      static_assert(std::is_arithmetic_v<V> || std::is_enum_v<V>,
+                    "send the members one by one");
+      auto at = m_bytes.size();
+      m_bytes.resize(at + sizeof(V));
+      std::memcpy(&m_bytes[at], &value, sizeof(V));
+    }
+    void io(const std::uint8_t* bytes, std::size_t size) {
+      m_bytes.insert(m_bytes.end(), bytes, bytes + size);
+    }
+    void io(const std::string& text) {
+      io(static_cast<std::uint32_t>(text.size()));
+      io(reinterpret_cast<const std::uint8_t*>(text.data()), text.size());
+    }
+
+    const std::vector<std::uint8_t>& bytes() const { return m_bytes; }
+    std::vector<std::uint8_t> frame(MessageKind kind) const;
+
+   private:
+    std::vector<std::uint8_t> m_bytes;
+  };
+
+  class Reader {
+   public:
+    Reader(const std::uint8_t* bytes, std::size_t size)
+        : m_at(bytes), m_end(bytes + size) {}
+
+    template <typename V>
+    void io(V& value) {
+      static_assert(std::is_arithmetic_v<V> || std::is_enum_v<V>,
+                    "receive the members one by one");
+      if (left() < sizeof(V)) {
+        m_good = false;
+        return;
+      }
+      std::memcpy(&value, m_at, sizeof(V));
+      m_at += sizeof(V);
+    }
+    void io(std::uint8_t* bytes, std::size_t size) {
+      if (left() < size) {
+        m_good = false;
+        return;
+      }
+      std::memcpy(bytes, m_at, size);
+      m_at += size;
+    }
+    void io(std::string& text) {
+      std::uint32_t size = 0;
+      io(size);
+      if (left() < size) {
+        m_good = false;
+        return;
+      }
+      text.assign(reinterpret_cast<const char*>(m_at), size);
+      m_at += size;
+    }
+
+    void skip(std::size_t size) {
+      if (left() < size) m_good = false;
+      m_at += std::min(size, left());
+    }
+
+    bool good() const { return m_good; }
+    const std::uint8_t* rest() const { return m_at; }
+    std::size_t left() const { return m_end - m_at; }
+
+   private:
+    const std::uint8_t* m_at;
+    const std::uint8_t* m_end;
+    bool m_good = true;
+  };
+
+  /**
+   * Everything a render of the field depends on, but not its grid:
+   * the bounds and resolution, the parameters, the stars, and the
+   * channels asked for. Read back into a field sized to render.
+   */
+  void write_field(Writer& w, const StarField& field);
+  bool read_field(Reader& r, StarField& field);
+
+  /**
+   * The field's results, its grid and channels, the latter read
+   * back into channels of the same kinds.
+   */
+  void write_results(Writer& w, const StarField& field);
+  bool read_results(Reader& r, StarField& field);
+
+  // whole, or not at all; false once the other end is gone
+  bool send_all(int fd, const std::vector<std::uint8_t>& bytes);
+  bool receive_all(int fd, std::uint8_t* bytes, std::size_t size);
+  // the next message, blocking
+  bool receive_frame(int fd, FrameHeader& header,
+                     std::vector<std::uint8_t>& body);
+
+  /**
+   * Takes complete frames off the front of bytes received so far,
+   * handing each to visit(header, body, size).
+   */
+  template <typename F>
+  void take_frames(std::vector<std::uint8_t>& inbox, F&& visit) {
+    std::size_t used = 0;
+    FrameHeader header;
+    while (inbox.size() - used >= sizeof header) {
+      std::memcpy(&header, &inbox[used], sizeof header);
+      if (inbox.size() - used < sizeof header + header.size) break;
+      visit(header, &inbox[used + sizeof header], std::size_t(header.size));
+      used += sizeof header + header.size;
+    }
+    inbox.erase(inbox.begin(), inbox.begin() + used);
+  }
+
+  /**
+   * A listening socket on "unix:/path" or "tcp:host:port" (port 0
+   * for any free one), non-blocking, or -1. The endpoint as
+   * listened on, port filled in, goes to resolved, and the path of
+   * a Unix socket, to remove when done, to unix_path.
+   */
+  int listen_on(const std::string& endpoint, std::string& resolved,
+                std::string& unix_path);
+  // a connected socket, or -1
+  int connect_to(const std::string& endpoint);
+  // the next connection waiting on the listener, or -1
+  int accept_from(int listener);
+}  // namespace mgs::wire
@@ -0,0 +1,56 @@
+#include "change_scheduler.h"
+
+#include <algorithm>
+
+namespace mgs {
+  void CancellableTask::launch(Task task) {
+    cancel();
+    m_cancelled = CancelToken();
+    m_worker = std::thread([task = std::move(task), cancelled = m_cancelled] {
+      task(cancelled);
+    });
+  }
+
+  void CancellableTask::cancel() {
+    m_cancelled.cancel();
+    if (m_worker.joinable()) m_worker.join();
+  }
+
+  ChangeScheduler::ChangeScheduler(QObject* parent, int coalesce_ms)
+      : QObject(parent) {
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setInterval(coalesce_ms);
+    QObject::connect(&m_frameTimer, &QTimer::timeout, this,
+                     &ChangeScheduler::sl_flush);
+  }
+
+  // The timer is deliberately not restarted on every edit; a
+  // continuous slider drag must still produce an update each frame
+  // rather than being deferred until the user lets go.
+  void ChangeScheduler::arm() {
+    if (!m_frameTimer.isActive()) m_frameTimer.start();
+  }
+
+  void ChangeScheduler::sl_star_changed(int index, const Star& star) {
+    auto& stars = m_pending.stars;
+    stars.erase(std::remove_if(stars.begin(), stars.end(),
+                               [index](const auto& c) {
+                                 return c.first == index;
+                               }),
+                stars.end());
+    stars.emplace_back(index, star);
+    arm();
+  }
+
+  void ChangeScheduler::sl_overall_changed(const Overall& overall) {
+    m_pending.overall = overall;
+    arm();
+  }
+
+  void ChangeScheduler::sl_flush() {
+    if (m_pending.empty()) return;
+    ParameterChanges changes = std::move(m_pending);
+    m_pending.clear();
+    sig_apply_changes(changes);
+  }
+}  // namespace mgs
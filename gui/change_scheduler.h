@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mgs.h"
+
+#include <QtCore/QTimer>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mgs
+{
+  // how long a burst of edits is gathered before being applied,
+  // roughly one frame at 60Hz.
+  static const int changeCoalesceMillis = 16;
+
+  /**
+   * The coalesced result of a burst of edits. Star changes are
+   * kept in the order they were last touched, one entry per star
+   * index (-1 being "all stars"), so that the latest edit to a
+   * given star wins, yet an "all masses" edit still lands in the
+   * right order relative to the individual stars.
+   */
+  struct ParameterChanges {
+    std::vector<std::pair<int, Star>> stars;
+    std::optional<Overall> overall;
+
+    bool empty() const { return stars.empty() && !overall; }
+    void clear() {
+      stars.clear();
+      overall.reset();
+    }
+  };
+
+  /**
+   * Runs one background task at a time. Launching a new task
+   * cancels (and reaps) the one in flight, so only the task for
+   * the latest inputs ever runs to completion. The task must poll
+   * the token it is handed (or pass it on to a render) and bail
+   * out once it is cancelled.
+   */
+  class CancellableTask
+  {
+  public:
+    using Task = std::function<void(const CancelToken&)>;
+
+    CancellableTask() = default;
+    CancellableTask(const CancellableTask&) = delete;
+    CancellableTask& operator=(const CancellableTask&) = delete;
+    ~CancellableTask() { cancel(); }
+
+    void launch(Task task);
+    void cancel();
+
+  private:
+    std::thread m_worker;
+    CancelToken m_cancelled;
+  };
+
+  /**
+   * Latest-wins scheduler sitting between StarConfig and
+   * StarFieldGUI. Every keystroke still arrives here, but
+   * only one sig_apply_changes() is emitted per frame, carrying
+   * everything that changed within it.
+   */
+  class ChangeScheduler : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    explicit ChangeScheduler(QObject* parent = nullptr,
+                             int coalesce_ms = changeCoalesceMillis);
+
+  public slots:
+    void sl_star_changed(int index, const Star& star);
+    void sl_overall_changed(const Overall& overall);
+
+  signals:
+    void sig_apply_changes(const ParameterChanges& changes);
+
+  private slots:
+    void sl_flush();
+
+  private:
+    void arm();
+
+    QTimer m_frameTimer;
+    ParameterChanges m_pending;
+  };
+}
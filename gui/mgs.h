@@ -32,6 +32,13 @@ namespace mgs
   // keep this number low.
   static const int freePointMassCube = 10;
 
+  // the count of one side of the coarse lattice used for the
+  // background set preview. Also cubed.
+  static const int setPreviewCube = 20;
+
+  // the mass slider's integer positions are scaled by this.
+  static const double massSliderScale = 1000.0;
+
   // we spcify arbitrary defaults in the default constructor
   template <typename T, typename I>
   struct FieldParmsSimulation : public FieldParms<T,I> {
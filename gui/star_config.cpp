@@ -19,6 +19,7 @@ namespace mgs
       std::exit(-1);
     }    
     q_sfield = new StarFieldGUI(q_graph);
+    q_scheduler = new ChangeScheduler(q_sfield);
     return q_graph;
   }
   
@@ -90,6 +91,7 @@ namespace mgs
 
         QObject::connect(q_starSelector, SIGNAL(activated(int)),  this, SLOT(sl_star_selected(int)));
 
+        QObject::connect(q_massSlider, &QSlider::valueChanged,   this, &StarConfig::sl_mass_slider_changed);
         QObject::connect(q_massEdit, &QLineEdit::textEdited,     this, &StarConfig::sl_star_config_changed);
         QObject::connect(q_starPosXEdit, &QLineEdit::textEdited, this, &StarConfig::sl_star_config_changed);
         QObject::connect(q_starPosYEdit, &QLineEdit::textEdited, this, &StarConfig::sl_star_config_changed);
@@ -100,13 +102,19 @@ namespace mgs
         QObject::connect(q_iterationLimitEdit,        &QLineEdit::textEdited, this, &StarConfig::sl_overall_config_changed);
         QObject::connect(q_escapeRadiusEdit,          &QLineEdit::textEdited, this, &StarConfig::sl_overall_config_changed);
         QObject::connect(q_simulationSpeedEdit,       &QLineEdit::textEdited, this, &StarConfig::sl_overall_config_changed);
+        QObject::connect(q_softeningEdit,             &QLineEdit::textEdited, this, &StarConfig::sl_overall_config_changed);
+        QObject::connect(q_forceExponentEdit,         &QLineEdit::textEdited, this, &StarConfig::sl_overall_config_changed);
+        QObject::connect(q_forceLawSelector, QOverload<int>::of(&QComboBox::activated),
+                         this, [this](int) { sl_overall_config_changed(QString()); });
         
         QObject::connect(q_sfield, &StarFieldGUI::sig_select_star,         this, &StarConfig::sl_select_star);
         QObject::connect(q_sfield, &StarFieldGUI::sig_set_number_of_stars, this, &StarConfig::sl_set_number_of_stars);
         
         QObject::connect(this, &StarConfig::sig_select_star, q_sfield, &StarFieldGUI::sl_star_selected);
-        QObject::connect(this, &StarConfig::sig_update_star, q_sfield, &StarFieldGUI::sl_update_star);
-        QObject::connect(this, &StarConfig::sig_update_overall, q_sfield, &StarFieldGUI::sl_update_overall);
+        // edits are coalesced per frame before they reach the star field
+        QObject::connect(this, &StarConfig::sig_update_star,    q_scheduler, &ChangeScheduler::sl_star_changed);
+        QObject::connect(this, &StarConfig::sig_update_overall, q_scheduler, &ChangeScheduler::sl_overall_changed);
+        QObject::connect(q_scheduler, &ChangeScheduler::sig_apply_changes, q_sfield, &StarFieldGUI::sl_apply_changes);
       }
       
       q_widget->show();
@@ -235,12 +243,24 @@ namespace mgs
       (q_escapeRadiusEdit = new QLineEdit)->setValidator(new QDoubleValidator);
       (q_iterationLimitEdit = new QLineEdit)->setValidator(new QIntValidator);
       (q_simulationSpeedEdit = new QLineEdit)->setValidator(new QDoubleValidator);
+      (q_softeningEdit = new QLineEdit)->setValidator(new QDoubleValidator);
+      (q_forceExponentEdit = new QLineEdit)->setValidator(new QDoubleValidator);
+
+      // in the order of ForceLawKind
+      q_forceLawSelector = new QComboBox;
+      for (auto kind : {ForceLawKind::newtonian, ForceLawKind::plummer,
+                        ForceLawKind::power_law}) {
+        q_forceLawSelector->addItem(QString(force_law_name(kind)));
+      }
 
       form->addRow(new QLabel("Grav Const"), q_gravitationalConstantEdit);
       form->addRow(new QLabel("delta T"), q_delta_t_Edit);
       form->addRow(new QLabel("Iter Limit"), q_iterationLimitEdit);
       form->addRow(new QLabel("Escape Radius"), q_escapeRadiusEdit);
       form->addRow(new QLabel("Simulation Speed"), q_simulationSpeedEdit);
+      form->addRow(new QLabel("Force Law"), q_forceLawSelector);
+      form->addRow(new QLabel("Softening"), q_softeningEdit);
+      form->addRow(new QLabel("Force Exponent"), q_forceExponentEdit);
 
       auto vbox = new QVBoxLayout;
       vbox->addLayout(form);
@@ -252,7 +272,8 @@ namespace mgs
 
   void StarConfig::sl_select_star(int index, const Star& star) {
     cout << "star " << index << ": " << star << endl;
-    auto [mass, pos] = star;
+    const auto& mass = star.mass;
+    const auto& pos = star.position;
     q_starSelector->setCurrentIndex(index + 1);
     q_massEdit->setText(QString::fromStdString(to_string(mass)));
     q_starPosXEdit->setText(QString::fromStdString(to_string(pos.vec[0])));
@@ -290,18 +311,32 @@ namespace mgs
     }   
   }
   
+  /* The mass slider drives the mass edit, and from there
+   * goes through the same path as typing a mass.
+   */
+  void StarConfig::sl_mass_slider_changed(int value) {
+    q_massEdit->setText(QString::fromStdString(to_string(value * massSliderScale)));
+    sl_star_config_changed(q_massEdit->text());
+  }
+
   /* The overall config group's changes are gathered here,
    * and are fowarded to the sig_ovarall_changed() signal.
+   * Only the fields of the form are taken; the parameters
+   * it has no field for (the integrator and the like) are
+   * kept as they were.
    */
   void StarConfig::sl_overall_config_changed(const QString& _text) {
     try {
-      m_overall = Overall {
-        std::stod(q_gravitationalConstantEdit->text().toStdString()),
-        std::stod(q_delta_t_Edit->text().toStdString()),
-        std::stoi(q_iterationLimitEdit->text().toStdString()),
-        std::stod(q_escapeRadiusEdit->text().toStdString()),
-        std::stod(q_simulationSpeedEdit->text().toStdString())
-      };
+      Overall overall = m_overall;
+      overall.gravitational_constant = std::stod(q_gravitationalConstantEdit->text().toStdString());
+      overall.delta_t = std::stod(q_delta_t_Edit->text().toStdString());
+      overall.iter_limit = std::stoi(q_iterationLimitEdit->text().toStdString());
+      overall.escape_radius = std::stod(q_escapeRadiusEdit->text().toStdString());
+      overall.simulation_speed = std::stod(q_simulationSpeedEdit->text().toStdString());
+      overall.force_law = static_cast<ForceLawKind>(q_forceLawSelector->currentIndex());
+      overall.softening = std::stod(q_softeningEdit->text().toStdString());
+      overall.force_exponent = std::stod(q_forceExponentEdit->text().toStdString());
+      m_overall = overall;
       sig_update_overall(m_overall);
     } catch (std::invalid_argument) {
       cout << "ignoring invalid strings in overall group" << '\n';
@@ -314,6 +349,9 @@ namespace mgs
     q_iterationLimitEdit->setText(QString::fromStdString(to_string(m_overall.iter_limit)));
     q_escapeRadiusEdit->setText(QString::fromStdString(to_string(m_overall.escape_radius)));
     q_simulationSpeedEdit->setText(QString::fromStdString(to_string(m_overall.simulation_speed)));
+    q_forceLawSelector->setCurrentIndex(static_cast<int>(m_overall.force_law));
+    q_softeningEdit->setText(QString::fromStdString(to_string(m_overall.softening)));
+    q_forceExponentEdit->setText(QString::fromStdString(to_string(m_overall.force_exponent)));
   }
   
   void StarConfig::sl_star_selected(int index) {
@@ -20,6 +20,7 @@
 #include <QGroupBox>
 
 #include "star_field_gui.h"
+#include "change_scheduler.h"
 
 namespace mgs
 {
@@ -51,6 +52,9 @@ namespace mgs
     QLineEdit   *q_iterationLimitEdit        = 0;
     QLineEdit   *q_escapeRadiusEdit          = 0;
     QLineEdit   *q_simulationSpeedEdit       = 0;
+    QComboBox   *q_forceLawSelector          = 0;
+    QLineEdit   *q_softeningEdit             = 0;
+    QLineEdit   *q_forceExponentEdit         = 0;
     
     QSlider     *q_freePointSlider        = 0;
     QLabel      *q_fpm_countLabel         = 0;
@@ -68,6 +72,7 @@ namespace mgs
     QGroupBox   *q_overallGroup     = 0;
 
     StarFieldGUI *q_sfield          = 0;
+    ChangeScheduler *q_scheduler    = 0;
 
     Overall m_overall;
     
@@ -93,6 +98,7 @@ namespace mgs
 
     void sl_star_config_changed(const QString& _text);
     void sl_overall_config_changed(const QString& _text);
+    void sl_mass_slider_changed(int value);
 
   signals:
     void sig_update_star(int index, const Star& star);
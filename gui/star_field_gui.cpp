@@ -40,6 +40,7 @@ namespace mgs {
         m_freePointMass(new QScatter3DSeries),
         m_stars(new QScatter3DSeries),
         m_sun(new QCustom3DItem),
+        m_setPreview(new QScatter3DSeries),
         m_freePointMassArray(0),
         m_starArray(0),
         m_freePointMassCube(freePointMassCube) {
@@ -66,6 +67,11 @@ namespace mgs {
     starGradient.setColorAt(1.0, Qt::yellow);
     init_series(m_stars, "star.obj", starGradient, 0.02);
 
+    QLinearGradient previewGradient(0, 0, 16, 1024);
+    previewGradient.setColorAt(0.0, Qt::darkCyan);
+    previewGradient.setColorAt(1.0, Qt::cyan);
+    init_series(m_setPreview, "largesphere.obj", previewGradient, 0.01);
+
     // For 'sun' we use a custom large sphere
     m_sun->setScaling(QVector3D(0.02f, 0.02f, 0.02f));
     m_sun->setMeshFile(QString::fromStdString(asset_dir + "largesphere.obj"));
@@ -75,6 +81,7 @@ namespace mgs {
 
     m_graph->addSeries(m_freePointMass);
     m_graph->addSeries(m_stars);
+    m_graph->addSeries(m_setPreview);
     m_graph->addCustomItem(m_sun);
 
     // Configure the axes according to the data
@@ -95,7 +102,10 @@ namespace mgs {
     updateFieldState();
   }
 
-  StarFieldGUI::~StarFieldGUI() { delete m_graph; }
+  StarFieldGUI::~StarFieldGUI() {
+    m_previewTask.cancel();
+    delete m_graph;
+  }
 
   void StarFieldGUI::generateFPMInitialStates() {
     c_fpms.clear();
@@ -113,22 +123,73 @@ namespace mgs {
   }
 
   void StarFieldGUI::eularianFPMAdvance() {
-    auto center_of_mass = compute_center_of_star_mass<double, int>(c_stars);
-
-    // here we iterate once through all the Free Point Masses
-    for (auto& [p, v] : c_fpms) {
-      Acceleration a;
+    // here we iterate once through all the Free Point Masses,
+    // with whichever integrator and force law the overall
+    // parameters call for
+    with_force_law(overall.force_law, overall.softening, overall.force_exponent, [&](const auto& law) {
+      auto accel = [&](const Position& at) {
+        return total_acceleration<double, int>(c_stars, at,
+                                               overall.gravitational_constant, law);
+      };
+      with_integrator(overall.integrator, [&](auto integrator) {
+        using Integrator = decltype(integrator);
+        for (auto& [p, v] : c_fpms) {
+          Integrator::step(p, v, overall.delta_t, accel);
+        }
+      });
+    });
+  }
 
-      // compute the acceleration vector
-      for (auto star : c_stars) {
-        a += compute_acceleration<double, int>(star, p,
-                                               overall.gravitational_constant);
+  /* Renders a coarse field in the background against a snapshot
+   * of the current stars and parameters, and shows the cells whose
+   * FPMs never escape. Any newer change cancels the render, so only
+   * the preview for the latest inputs is ever shown.
+   */
+  void StarFieldGUI::recomputeSetPreview() {
+    if (c_stars.empty()) return;
+
+    m_previewTask.launch([this, stars = c_stars, parms = overall](
+                             const CancelToken& cancelled) {
+      Bounds box{Coordinate{-xRange, -yRange, -zRange},
+                 Coordinate{xRange, yRange, zRange}};
+      StarField field(box, setPreviewCube + 1, 3, parms.iter_limit,
+                      parms.gravitational_constant, parms.escape_radius,
+                      parms.delta_t);
+      // and the force law, integrator and the rest, as the simulation
+      field.parms = decltype(field.parms)(parms);
+      field.stars = stars;
+
+      RenderOptions options;
+      options.token = cancelled;
+      field.render_with_callback(nullptr, options);
+      if (cancelled) return;
+
+      std::vector<QVector3D> bound;
+      for (indexer_t k = 0; k < field.cube_size; ++k) {
+        for (indexer_t j = 0; j < field.cube_size; ++j) {
+          for (indexer_t i = 0; i < field.cube_size; ++i) {
+            Index idx{i, j, k};
+            if (field[idx] < field.parms.iter_limit) continue;
+            auto c = field.index2coordinate(idx);
+            bound.emplace_back(c[0], c[1], c[2]);
+          }
+        }
       }
 
-      // one step of the Eulerian Interation
-      v += a * overall.delta_t;
-      p += v * overall.delta_t;
-    }
+      QMetaObject::invokeMethod(
+          this,
+          [this, cancelled, bound = std::move(bound)] {
+            if (!cancelled) showSetPreview(bound);
+          },
+          Qt::QueuedConnection);
+    });
+  }
+
+  void StarFieldGUI::showSetPreview(const std::vector<QVector3D>& bound) {
+    auto array = new QScatterDataArray;
+    array->reserve(bound.size());
+    for (const auto& p : bound) array->append(QScatterDataItem(p));
+    m_setPreview->dataProxy()->resetArray(array);
   }
 
   /* The main computation loop for the GUI, where updates shall take place.
@@ -233,14 +294,27 @@ namespace mgs {
 
   void StarFieldGUI::sl_update_star(int index, const Star& star) {
     cout << "update star: " << index << " with: " << star << '\n';
-    if (index >= 0) {
-      c_stars[index] = star;
-    } else {  // update all stars with the same mass
-      for (auto st = c_stars.begin(); st != c_stars.end(); ++st)
-        st->mass = star.mass;
+    ParameterChanges changes;
+    changes.stars.emplace_back(index, star);
+    sl_apply_changes(changes);
+  }
+
+  /* Everything the scheduler gathered within a frame is applied
+   * here in one go, followed by a single refresh and recompute.
+   */
+  void StarFieldGUI::sl_apply_changes(const ParameterChanges& changes) {
+    for (const auto& [index, star] : changes.stars) {
+      if (index >= 0) {
+        if (index < static_cast<int>(c_stars.size())) c_stars[index] = star;
+      } else {  // update all stars with the same mass
+        for (auto st = c_stars.begin(); st != c_stars.end(); ++st)
+          st->mass = star.mass;
+      }
     }
+    if (changes.overall) overall = *changes.overall;
 
     updateFieldState();
+    recomputeSetPreview();
   }
 
   void StarFieldGUI::sl_update_overall(const Overall& ov) {
@@ -263,6 +337,7 @@ namespace mgs {
 
     sig_set_number_of_stars(c_stars.size());
     updateFieldState();
+    recomputeSetPreview();
   }
 
   // Octahedron is also easily derived from a cube.
@@ -282,6 +357,7 @@ namespace mgs {
 
     sig_set_number_of_stars(c_stars.size());
     updateFieldState();
+    recomputeSetPreview();
   }
 
   // Hexahedron is dirt easy. It's a cube, after all.
@@ -304,6 +380,7 @@ namespace mgs {
 
     sig_set_number_of_stars(c_stars.size());
     updateFieldState();
+    recomputeSetPreview();
   }
 
   void StarFieldGUI::sl_make_dodecahedron() {
@@ -333,6 +410,7 @@ namespace mgs {
     }
     sig_set_number_of_stars(c_stars.size());
     updateFieldState();
+    recomputeSetPreview();
   }
 
   void StarFieldGUI::sl_make_icosahedron() {
@@ -355,5 +433,6 @@ namespace mgs {
     }
     sig_set_number_of_stars(c_stars.size());
     updateFieldState();
+    recomputeSetPreview();
   }
 }  // namespace mgs
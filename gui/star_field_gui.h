@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mgs.h"
+#include "change_scheduler.h"
 
 #include <QtDataVisualization/qscatterdataproxy.h>
 #include <QtDataVisualization/qvalue3daxis.h>
@@ -49,6 +50,7 @@ namespace mgs
     void generateField();
     void generateFPMInitialStates();
     void eularianFPMAdvance();
+    void recomputeSetPreview();
                        
   public slots:
     void sl_setFreePointCube(int side);
@@ -72,12 +74,15 @@ namespace mgs
     void sl_reset_eularian();
     void sl_update_overall(const Overall& overall);
     void sl_reset_arrows();
+    void sl_apply_changes(const ParameterChanges& changes);
     
   signals:
     void sig_select_star(int index, const Star& star);
     void sig_set_number_of_stars(int count);
 
   private:
+    void showSetPreview(const std::vector<QVector3D>& bound);
+
     Q3DScatter *m_graph;
 
     QTimer m_simulationTimer;
@@ -87,6 +92,8 @@ namespace mgs
     QScatter3DSeries *m_freePointMass;
     QScatter3DSeries *m_stars;
     QCustom3DItem *m_sun;
+    QScatter3DSeries *m_setPreview;
+    CancellableTask m_previewTask;
 
     std::vector<Star> c_stars;
     std::vector<PosVel> c_fpms;
@@ -1,9 +1,26 @@
+#include <animation>
+#include <adaptive>
 #include <compute>
+#include <daemon>
+#include <distributed>
 #include <marching_tetrahedra>
+#include <observers>
+#include <pyramid>
+#include <shared_field>
+#include <sweep>
 
+#include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "gtest/gtest.h"
 
@@ -95,6 +112,33 @@ TEST_F(ComputeTest, test_math_on_Vector) {
 }
 
 TEST_F(ComputeTest, test_marching_tetraherda) {
+  // bound (10) below i = 1, escaping (0) from there on
+  for (auto k = 0; k < field.cube_size; ++k)
+    for (auto j = 0; j < field.cube_size; ++j)
+      for (auto i = 0; i < field.cube_size; ++i)
+        field[Index{i, j, k}] = i == 0 ? 10 : 0;
+  Index lmp{0, 0, 0};
+
+  // the integer counts put the surface halfway along the cells
+  auto coarse = MakeTesselation(field).isosurface_cube(lmp, 5);
+  ASSERT_EQ(coarse.size(), 6u);
+  for (const auto& polygon : coarse)
+    for (const auto& p : polygon) EXPECT_DOUBLE_EQ(p[0], -8);
+
+  // the smooth escape times move it to where they cross 5
+  auto& smooth = field.channels.request(ChannelKind::escape_time);
+  smooth.allocate(field.grid.size());
+  for (auto k = 0; k < field.cube_size; ++k)
+    for (auto j = 0; j < field.cube_size; ++j) {
+      const float row[] = {10, 2.5, 0};
+      smooth.store(field.offset({0, j, k}), row, 3);
+    }
+  auto fine = MakeTesselation(field).isosurface_cube(lmp, 5);
+  ASSERT_EQ(fine.size(), 6u);
+  for (const auto& polygon : fine) {
+    EXPECT_TRUE(polygon.size() == 3 || polygon.size() == 4);
+    for (const auto& p : polygon) EXPECT_NEAR(p[0], -16 + 16 * 2.0 / 3, 1e-9);
+  }
 }
 
 TEST_F(ComputeTest, test_make_tesselation) {
@@ -114,6 +158,1097 @@ TEST_F(ComputeTest, test_make_tesselation) {
   }
 }
 
+class RenderTest : public testing::Test {
+ public:
+  StarField field;
+
+  virtual void SetUp() override {
+    Bounds box{Coordinate{-4, -4, -4}, Coordinate{4, 4, 4}};
+    field = StarField(box, 12, 3, 64, 1.0, 6.0, 0.05);
+    field.stars.push_back(Star{1.0, {-1, 0, 0}});
+    field.stars.push_back(Star{1.0, {1, 0, 0}});
+  }
+};
+
+TEST_F(RenderTest, render_fills_grid) {
+  RenderOptions opts;
+  opts.brick_size = 5;
+  opts.threads = 3;
+  std::atomic<int> calls{0};
+  field.render_with_callback([&](Index, Position) { ++calls; }, opts);
+
+  EXPECT_EQ(calls, static_cast<int>(field.grid.size()));
+  for (indexer_t k = 0; k < field.cube_size; ++k) {
+    for (indexer_t j = 0; j < field.cube_size; ++j) {
+      for (indexer_t i = 0; i < field.cube_size; ++i) {
+        Index idx{i, j, k};
+        auto expected = render_single_cell<floating_t, iterant_t>(
+            field.index2coordinate(idx), Velocity{}, field.stars,
+            field.center_of_star_mass, field.parms);
+        EXPECT_EQ(field[idx], expected);
+      }
+    }
+  }
+}
+
+TEST_F(RenderTest, cancel_and_progress) {
+  RenderOptions opts;
+  opts.threads = 2;
+  opts.brick_size = 4;
+  opts.token.cancel();  // cancelled before it starts
+  auto job = field.render_async(nullptr, opts);
+  EXPECT_EQ(job.wait(), RenderStatus::cancelled);
+  EXPECT_EQ(job.progress().cells_done, 0u);
+  EXPECT_EQ(job.progress().cells_total, field.grid.size());
+
+  auto full = field.render_async();
+  EXPECT_EQ(full.wait(), RenderStatus::completed);
+  EXPECT_TRUE(full.finished());
+  EXPECT_EQ(full.progress().cells_done, field.grid.size());
+  EXPECT_DOUBLE_EQ(full.progress().fraction(), 1.0);
+
+  // a render that completes leaves the caller's token as it was
+  RenderOptions again;
+  field.render_with_callback(nullptr, again);
+  EXPECT_FALSE(again.token.cancelled());
+}
+
+TEST_F(RenderTest, brick_callback) {
+  StarField direct = field;
+  direct.render_with_callback(nullptr);
+
+  RenderOptions opts;
+  opts.brick_size = 5;
+  std::mutex m;
+  std::size_t cells = 0;
+  std::vector<iterant_t> seen(field.grid.size(), untouched);
+  field.render_with_brick_callback(
+      [&](const Brick& brick, Span<const iterant_t> iters) {
+        std::lock_guard<std::mutex> lock(m);
+        cells += iters.size();
+        EXPECT_EQ(iters.size(), brick.cells());
+        std::size_t n = 0;
+        for_each_cell(brick, [&](const idx_vector_t& ijk) {
+          seen[field.offset(ijk)] = iters[n++];
+        });
+      },
+      opts);
+
+  EXPECT_EQ(cells, field.grid.size());
+  EXPECT_EQ(seen, direct.grid);
+  EXPECT_EQ(field.grid, direct.grid);
+}
+
+TEST_F(RenderTest, progressive_levels) {
+  StarField direct = field;
+  direct.render_with_callback(nullptr);
+
+  auto sub = make_level_subscriber();
+  std::atomic<std::uint64_t> cells{0};
+  RenderOptions opts;
+  opts.brick_size = 5;
+  auto job = field.render_progressive({sub}, [&](Index, Position) { ++cells; },
+                                      opts, 8);
+  EXPECT_EQ(job.wait(), RenderStatus::completed);
+
+  // each cell is computed once, same as a direct render
+  EXPECT_EQ(cells, field.grid.size());
+  EXPECT_EQ(field.grid, direct.grid);
+
+  std::vector<indexer_t> strides;
+  LevelUpdate update;
+  while (sub->try_pop(update)) strides.push_back(update.stride);
+  EXPECT_EQ(strides, (std::vector<indexer_t>{8, 4, 2, 1}));
+  EXPECT_TRUE(update.final());
+  EXPECT_EQ(update.cells_done, field.grid.size());
+  EXPECT_EQ(field.at_stride(idx_vector_t{7, 9, 11}, 4), (field[Index{4, 8, 8}]));
+}
+
+TEST_F(RenderTest, step_observers) {
+  Position start{0.5, 0.5, 0.0};
+  auto center = compute_center_of_star_mass<floating_t, indexer_t>(field.stars);
+  auto plain = render_single_cell<floating_t, iterant_t>(
+      start, Velocity{}, field.stars, center, field.parms);
+
+  StepCounter counter;
+  TrajectoryRecorder recorder(2);
+  MinDistanceTracker closest(field.stars);
+  auto observed = render_single_cell<floating_t, iterant_t>(
+      start, Velocity{}, field.stars, center, field.parms,
+      observe_all(counter, recorder, closest));
+
+  EXPECT_EQ(plain, observed);
+  EXPECT_EQ(counter.steps, static_cast<std::size_t>(observed));
+  EXPECT_EQ(recorder.trajectory.size(), (counter.steps + 1) / 2);
+  EXPECT_GE(closest.nearest_star, 0);
+  EXPECT_LT(closest.min_distance, (start - field.stars[0].position).norm());
+}
+
+// One period of a circular orbit about a unit mass, returning
+// how far from the starting point the FPM ends up.
+template <typename Integrator>
+static floating_t circular_orbit_error(floating_t dt) {
+  std::vector<Star> stars{Star{1.0, {0, 0, 0}}};
+  Position p{1, 0, 0};
+  Velocity v{0, 1, 0};
+  auto accel = [&](const Position& at) {
+    return total_acceleration<floating_t, iterant_t>(stars, at, 1.0);
+  };
+  auto steps = static_cast<int>(std::round(2.0 * M_PI / dt));
+  for (int i = 0; i < steps; ++i) Integrator::step(p, v, 2.0 * M_PI / steps, accel);
+  return (p - Position{1, 0, 0}).norm();
+}
+
+TEST(Integrators, higher_order_is_more_accurate) {
+  auto euler = circular_orbit_error<Euler>(0.01);
+  auto leapfrog = circular_orbit_error<Leapfrog>(0.01);
+  auto yoshida = circular_orbit_error<Yoshida4>(0.01);
+  auto rk4 = circular_orbit_error<RK4>(0.01);
+  EXPECT_LT(leapfrog, euler);
+  EXPECT_LT(yoshida, leapfrog);
+  EXPECT_LT(rk4, leapfrog);
+
+  // 4th order: halving the step cuts the error by roughly 16
+  EXPECT_GT(circular_orbit_error<Yoshida4>(0.1) /
+                circular_orbit_error<Yoshida4>(0.05), 10.0);
+}
+
+TEST_F(RenderTest, adaptive_steps_in_simulated_time) {
+  auto center = compute_center_of_star_mass<floating_t, indexer_t>(field.stars);
+  auto parms = field.parms;
+  parms.adaptive = true;
+
+  // far out, the FPM falls in slowly; the adaptive step covers the
+  // same simulated time, to the limit, in far fewer steps
+  Position start{4.0, 3.0, 0.0};
+  StepCounter fixed_steps, adaptive_steps;
+  auto fixed = render_single_cell<floating_t, iterant_t, Leapfrog>(
+      start, Velocity{}, field.stars, center, field.parms, fixed_steps);
+  auto adaptive = render_single_cell_adaptive<floating_t, iterant_t, Leapfrog>(
+      start, Velocity{}, field.stars, center, parms, adaptive_steps);
+
+  EXPECT_LT(adaptive_steps.steps, fixed_steps.steps);
+  EXPECT_EQ(fixed, parms.iter_limit);
+  EXPECT_EQ(adaptive, fixed);
+
+  // an FPM already outside the escape radius takes no time at all
+  EXPECT_EQ((render_single_cell_adaptive<floating_t, iterant_t>(
+                Position{5, 5, 5}, Velocity{}, field.stars, center, parms)),
+            0);
+
+  // and fields rendered either way are of the same shape
+  StarField fixed_field = field;
+  fixed_field.render_with_callback(nullptr);
+  field.parms.adaptive = true;
+  field.render_with_callback(nullptr);
+  std::size_t agree = 0;
+  for (std::size_t i = 0; i < field.grid.size(); ++i) {
+    agree += (field.grid[i] >= field.parms.iter_limit) ==
+             (fixed_field.grid[i] >= field.parms.iter_limit);
+  }
+  EXPECT_GT(double(agree) / field.grid.size(), 0.9);
+}
+
+TEST(Kepler, fast_forward_matches_stepping) {
+  // a single star is exactly a point mass, so any radius will do
+  std::vector<Star> stars{Star{1.0, {0, 0, 0}}};
+  Position center{0, 0, 0};
+  FieldParms<floating_t, iterant_t> parms(1.0, 0.001, 30000, 10.0,
+                                          IntegratorKind::rk4);
+  auto kepler = parms;
+  kepler.kepler_tolerance = 0.01;
+
+  // bound well within the escape radius, orbiting until the limit
+  Position p{2, 0, 0};
+  Velocity returning{0.3, 0.6, 0};
+  EXPECT_EQ((render_single_cell<floating_t, iterant_t, RK4>(
+                p, returning, stars, center, parms)),
+            parms.iter_limit);
+  EXPECT_EQ((render_single_cell<floating_t, iterant_t, RK4>(
+                p, returning, stars, center, kepler)),
+            parms.iter_limit);
+
+  // bound, but with its apoapsis beyond the escape radius
+  Velocity escaping{0.7, 0.65, 0};
+  StepCounter stepped_steps, kepler_steps;
+  auto stepped = render_single_cell<floating_t, iterant_t, RK4>(
+      p, escaping, stars, center, parms, stepped_steps);
+  auto fast = render_single_cell<floating_t, iterant_t, RK4>(
+      p, escaping, stars, center, kepler, kepler_steps);
+  EXPECT_LT(stepped, parms.iter_limit);
+  EXPECT_NEAR(fast, stepped, 2);
+  EXPECT_EQ(kepler_steps.steps, 0u);
+
+  // where the orbit comes back, it comes back to the same radius,
+  // inbound
+  auto leg = kepler_outbound_leg<floating_t>(p, returning, center, 1.0, 10.0);
+  ASSERT_TRUE(leg.applicable);
+  EXPECT_FALSE(leg.escapes);
+  EXPECT_NEAR(leg.p.norm(), p.norm(), 1e-9);
+  EXPECT_LT(leg.p.dot(leg.v), 0.0);
+}
+
+TEST(StarKernels, match_direct_sum) {
+  std::vector<Star> stars{Star{1.0, {-1, -1, -1}}, Star{2.0, {1, -1, 1}},
+                          Star{1.5, {-1, 1, 1}}, Star{0.5, {1, 1, -1}}};
+  Position center =
+      compute_center_of_star_mass<floating_t, iterant_t>(stars);
+  DirectSumKernel<floating_t, iterant_t> direct(stars, center, 1.3);
+  FixedStarKernel<floating_t, 4> fixed(stars, center, 1.3);
+  DynamicStarKernel<floating_t> dynamic(stars, center, 1.3);
+
+  for (auto p : {Position{0.3, -0.2, 2.5}, Position{-3, 1, 0.1}}) {
+    auto expected = direct(p);
+    EXPECT_EQ(fixed(Vec3<floating_t>(p)).position(), expected);
+    EXPECT_EQ(dynamic(Vec3<floating_t>(p)).position(), expected);
+  }
+  EXPECT_TRUE(with_star_kernel<floating_t>(
+      stars, center, 1.3, 0.0, Newtonian<floating_t>{}, 0.0,
+      [](const auto& k) {
+        return std::is_same_v<std::decay_t<decltype(k)>,
+                              FixedStarKernel<floating_t, 4>>;
+      }));
+}
+
+TEST(ForceLaws, softening_and_power_law) {
+  Star star{2.0, {1, 0, 0}};
+  Position p{1, 3, 4};  // 5 from the star
+  auto newton = compute_acceleration<floating_t, iterant_t>(star, p, 1.0);
+  EXPECT_NEAR(newton.norm(), 2.0 / 25, 1e-15);
+
+  // no softening, and the inverse square, are both Newtonian
+  Plummer<floating_t> unsoftened(0, 2);
+  PowerLaw<floating_t> square(0, 2);
+  auto plummer =
+      compute_acceleration<floating_t, iterant_t>(star, p, 1.0, unsoftened);
+  auto power = compute_acceleration<floating_t, iterant_t>(star, p, 1.0, square);
+  EXPECT_NEAR((plummer - newton).norm(), 0, 1e-15);
+  EXPECT_NEAR((power - newton).norm(), 0, 1e-15);
+
+  // an inverse first power falls off as 1 / r
+  PowerLaw<floating_t> inverse(0, 1);
+  auto weaker =
+      compute_acceleration<floating_t, iterant_t>(star, p, 1.0, inverse);
+  EXPECT_NEAR(weaker.norm(), 2.0 / 5, 1e-15);
+  FarField<floating_t> far({star}, star.position, 1.0, 0.01, inverse);
+  EXPECT_TRUE(std::isinf(far.switch_radius));
+
+  // softened, the pull stays finite right at the star
+  Plummer<floating_t> soft(0.1, 2);
+  Position near = star.position + Position{1e-9, 0, 0};
+  auto close =
+      compute_acceleration<floating_t, iterant_t>(star, near, 1.0, soft);
+  EXPECT_LT(close.norm(), 1e-3);
+}
+
+TEST_F(RenderTest, softened_render_matches_single_cell) {
+  field.parms.force_law = ForceLawKind::plummer;
+  field.parms.softening = 0.2;
+  field.render_with_callback(nullptr);
+
+  Index idx{3, 7, 5};
+  EXPECT_EQ(field[idx], (render_single_cell<floating_t, iterant_t>(
+                            field.index2coordinate(idx), Velocity{},
+                            field.stars, field.center_of_star_mass,
+                            field.parms)));
+}
+
+TEST(StarTree, approximates_direct_sum) {
+  // a lumpy random cluster
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<floating_t> u(-1, 1);
+  std::vector<Star> stars;
+  for (int i = 0; i < 400; ++i) {
+    Position c = i % 2 ? Position{2, 0, 0} : Position{-1, 1, 0};
+    stars.push_back(Star{1.0 + u(rng) / 2, c + Position{u(rng), u(rng), u(rng)}});
+  }
+  Position center = compute_center_of_star_mass<floating_t, iterant_t>(stars);
+  DynamicStarKernel<floating_t> direct(stars, center, 1.0);
+
+  StarTree<floating_t> exact(stars, 0.0);
+  StarTree<floating_t> coarse(stars, 0.5);
+  TreeKernel<floating_t> walk_all(exact, stars, center, 1.0);
+  TreeKernel<floating_t> walk(coarse, stars, center, 1.0);
+  EXPECT_GT(coarse.nodes().size(), 1u);
+
+  for (auto p : {Position{6, 1, -2}, Position{0.5, 0.5, 0.2},
+                 Position{-3, -4, 5}}) {
+    Vec3<floating_t> v(p);
+    auto expected = direct(v);
+    EXPECT_LT((walk_all(v) - expected).norm(), 1e-12 * expected.norm());
+    EXPECT_LT((walk(v) - expected).norm(), 1e-2 * expected.norm());
+  }
+}
+
+TEST_F(RenderTest, tree_render_matches_single_cell) {
+  field.parms.opening_angle = 0.7;
+  field.render_with_callback(nullptr);
+  ASSERT_TRUE(field.star_tree);
+
+  Index idx{2, 9, 4};
+  EXPECT_EQ(field[idx], (render_single_cell<floating_t, iterant_t>(
+                            field.index2coordinate(idx), Velocity{},
+                            *field.star_tree, field.stars,
+                            field.center_of_star_mass, field.parms)));
+}
+
+TEST(AccelGrid, interpolates_within_reported_error) {
+  std::vector<Star> stars{Star{1.0, {-1, 0, 0}}, Star{1.0, {1, 0, 0}}};
+  Position center{0, 0, 0};
+  DynamicStarKernel<floating_t> exact(stars, center, 1.0);
+  Vec3<floating_t> lo{-4, -4, -4}, hi{4, 4, 4};
+
+  AccelGrid<floating_t> linear(exact, stars, lo, hi, 41,
+                               AccelInterpolation::trilinear, 0.5, 2);
+  AccelGrid<floating_t> cubic(exact, stars, lo, hi, 41,
+                              AccelInterpolation::tricubic, 0.5, 2);
+  ASSERT_TRUE(linear.complete());
+  EXPECT_GT(linear.error().samples, 0u);
+  EXPECT_LT(linear.error().rms_relative, 1e-3);
+  EXPECT_LT(cubic.error().rms_relative, 1e-3);
+
+  AccelGridKernel<floating_t, DynamicStarKernel<floating_t>> kernel(cubic,
+                                                                    exact);
+  Vec3<floating_t> away{2.13, -1.71, 0.37};
+  Vec3<floating_t> a;
+  ASSERT_TRUE(cubic.lookup(away, a));
+  EXPECT_LT((a - exact(away)).norm(),
+            cubic.error().max_relative * exact(away).norm());
+
+  // near a star, and out of bounds, it is exact
+  for (auto p : {Vec3<floating_t>{1.05, 0.02, 0}, Vec3<floating_t>{9, 0, 0}}) {
+    EXPECT_FALSE(cubic.lookup(p, a));
+    EXPECT_EQ(kernel(p), exact(p));
+  }
+}
+
+TEST_F(RenderTest, accel_grid_render) {
+  field.parms.accel_grid_size = 48;
+  field.parms.accel_interpolation = AccelInterpolation::tricubic;
+  field.render_with_callback(nullptr);
+  ASSERT_TRUE(field.accel_grid);
+  EXPECT_LT(field.accel_grid->error().rms_relative, 1e-2);
+
+  // an approximation, but the field should barely change
+  StarField exact = field;
+  exact.parms.accel_grid_size = 0;
+  exact.render_with_callback(nullptr);
+  std::size_t same = 0;
+  for (std::size_t i = 0; i < field.grid.size(); ++i)
+    same += field.grid[i] == exact.grid[i];
+  EXPECT_GT(same, field.grid.size() * 9 / 10);
+}
+
+TEST_F(RenderTest, capture_and_basins) {
+  field.parms.capture_radius = 0.3;
+  field.stars[1].capture_radius = 0.5;
+  field.channels.request(ChannelKind::captured_by, ChannelStorage::u8);
+  field.render_with_callback(nullptr);
+  const Channel* basin = field.channels.find(ChannelKind::captured_by);
+  ASSERT_EQ(basin->cells(), field.grid.size());
+
+  std::size_t captured[2] = {0, 0};
+  for (std::size_t i = 0; i < field.grid.size(); ++i) {
+    auto star = static_cast<star_index_t>(basin->get(i));
+    if (star == not_captured) continue;
+    ASSERT_TRUE(star == 0 || star == 1);
+    ++captured[star];
+    EXPECT_EQ(field.grid[i], field.parms.iter_limit);
+  }
+  EXPECT_GT(captured[0], 0u);
+  EXPECT_GT(captured[1], 0u);
+
+  // a cell starting within a star is captured straight away
+  Position center{0, 0, 0};
+  CellOutcome<floating_t> outcome;
+  StepCounter steps;
+  DirectSumKernel<floating_t, iterant_t> kernel(
+      field.stars, center, 1.0, 0.0, Newtonian<floating_t>{}, 0.3);
+  EXPECT_EQ((integrate_cell<floating_t, iterant_t>(
+                Position{-0.9, 0.1, 0}, Velocity{}, kernel, center,
+                field.parms, steps, &outcome)),
+            field.parms.iter_limit);
+  EXPECT_EQ(outcome.captured_by, 0);
+  EXPECT_EQ(steps.steps, 0u);
+
+  // and the tree finds the same stars
+  StarTree<floating_t> tree(field.stars, 0.5, 0.3);
+  TreeKernel<floating_t> walk(tree, field.stars, center, 1.0);
+  ASSERT_TRUE(walk.has_capture);
+  EXPECT_EQ(walk.capture(Vec3<floating_t>{0.6, 0.2, 0}), 1);
+  EXPECT_EQ(walk.capture(Vec3<floating_t>{-1.2, 0.1, 0}), 0);
+  EXPECT_EQ(walk.capture(Vec3<floating_t>{0, 0.1, 0}), not_captured);
+}
+
+TEST(Channels, storage) {
+  for (float f : {0.0f, 1.0f, -2.5f, 65504.0f, 6.1e-5f, 1e-7f, 0.333f}) {
+    float back = half_to_float(float_to_half(f));
+    EXPECT_NEAR(back, f, std::abs(f) / 1024 + 1e-7f);
+  }
+  EXPECT_TRUE(std::isnan(half_to_float(float_to_half(NAN))));
+  EXPECT_TRUE(std::isinf(half_to_float(float_to_half(1e6f))));
+
+  Channel speed(ChannelKind::final_speed, ChannelStorage::u8, {0, 2});
+  speed.allocate(3);
+  EXPECT_EQ(speed.bytes(), 3u);
+  float values[] = {0.5f, 3.0f};
+  speed.store(1, values, 2);
+  EXPECT_NEAR(speed.get(1), 0.5f, 1.0f / 255);
+  EXPECT_EQ(speed.get(2), 2.0f);  // clamped
+
+  Channel direction(ChannelKind::escape_direction, ChannelStorage::f16,
+                    default_channel_range(ChannelKind::escape_direction));
+  direction.allocate(2);
+  EXPECT_EQ(direction.bytes(), 12u);
+  EXPECT_TRUE(std::isnan(direction.get(1, 2)));
+}
+
+TEST_F(RenderTest, channels_follow_the_grid) {
+  field.channels.request(ChannelKind::final_speed, ChannelStorage::f32);
+  field.channels.request(ChannelKind::min_star_distance, ChannelStorage::f16);
+  field.channels.request(ChannelKind::escape_direction, ChannelStorage::f32);
+  RenderOptions opts;
+  opts.brick_size = 5;
+  field.render_with_callback(nullptr, opts);
+
+  const Channel* speed = field.channels.find(ChannelKind::final_speed);
+  const Channel* distance = field.channels.find(ChannelKind::min_star_distance);
+  const Channel* direction = field.channels.find(ChannelKind::escape_direction);
+  ASSERT_TRUE(speed && distance && direction);
+  EXPECT_EQ(field.channels.bytes(), field.grid.size() * (4 + 2 + 12));
+
+  for (auto ijk : {idx_vector_t{0, 0, 0}, idx_vector_t{4, 6, 5},
+                   idx_vector_t{11, 3, 7}}) {
+    auto cell = field.offset(ijk);
+    MinDistanceTracker closest(field.stars);
+    closest(field.cell_position(ijk), Velocity{});
+    auto iters = render_single_cell<floating_t, iterant_t>(
+        field.cell_position(ijk), Velocity{}, field.stars,
+        field.center_of_star_mass, field.parms, closest);
+    ASSERT_EQ(field.grid[cell], iters);
+    EXPECT_NEAR(distance->get(cell), closest.min_distance,
+                closest.min_distance / 512);
+    EXPECT_FALSE(std::isnan(speed->get(cell)));
+
+    Vec3<floating_t> d{direction->get(cell, 0), direction->get(cell, 1),
+                       direction->get(cell, 2)};
+    if (iters < field.parms.iter_limit)
+      EXPECT_NEAR(d.norm(), 1.0, 1e-6);
+    else
+      EXPECT_EQ(d.norm(), 0.0);
+  }
+}
+
+TEST_F(RenderTest, smooth_escape_time) {
+  field.channels.request(ChannelKind::escape_time, ChannelStorage::f32);
+  field.render_with_callback(nullptr);
+  const Channel* smooth = field.channels.find(ChannelKind::escape_time);
+  ASSERT_TRUE(smooth);
+
+  // within the last step of the count, and fractional somewhere
+  bool fractional = false;
+  for (std::size_t cell = 0; cell < field.grid.size(); ++cell) {
+    float t = smooth->get(cell);
+    auto iters = field.grid[cell];
+    if (iters < field.parms.iter_limit) {
+      EXPECT_GT(t, iters - 1);
+      EXPECT_LE(t, iters + 1e-4);
+      fractional |= t != std::floor(t);
+    } else {
+      EXPECT_EQ(t, field.parms.iter_limit);
+    }
+  }
+  EXPECT_TRUE(fractional);
+}
+
+TEST_F(RenderTest, resume_raises_the_limit) {
+  field.parms.kepler_tolerance = 1e-3;
+  field.parms.capture_radius = 0.1;
+  field.channels.request(ChannelKind::escape_time);
+  RenderOptions opts;
+  opts.brick_size = 5;
+  opts.threads = 3;
+  StarField fresh = field;
+  fresh.parms.iter_limit = 256;
+  fresh.render_with_callback(nullptr, opts);
+
+  field.resume.keep(true);
+  field.render_with_callback(nullptr, opts);
+  std::size_t bound = std::count(field.grid.begin(), field.grid.end(), 64);
+  EXPECT_EQ(field.resume.limit(), 64);
+  EXPECT_GT(field.resume.size(), 0u);
+  EXPECT_LE(field.resume.size(), bound);
+
+  // only the orbits stopped at 64 go on, and as if they never stopped
+  field.parms.iter_limit = 256;
+  field.render_with_callback(nullptr, opts);
+  EXPECT_EQ(field.resume.limit(), 256);
+  EXPECT_EQ(field.grid, fresh.grid);
+  const Channel* resumed = field.channels.find(ChannelKind::escape_time);
+  const Channel* expected = fresh.channels.find(ChannelKind::escape_time);
+  for (std::size_t cell = 0; cell < field.grid.size(); ++cell)
+    ASSERT_EQ(resumed->get(cell), expected->get(cell)) << cell;
+
+  // anything else changing starts over
+  field.parms.delta_t = 0.04;
+  field.parms.iter_limit = 512;
+  field.resume.keep(false);
+  field.render_with_callback(nullptr, opts);
+  EXPECT_EQ(field.resume.size(), 0u);
+}
+
+TEST(Scheduler, longest_first_with_stealing) {
+  std::vector<double> costs(200);
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> cost(0.0, 100.0);
+  for (auto& c : costs) c = cost(rng);
+
+  // one worker takes them strictly longest first
+  std::vector<brick_id_t> order;
+  for_each_brick_longest_first(costs, 1, CancelToken{},
+                               [&](brick_id_t b) { order.push_back(b); });
+  ASSERT_EQ(order.size(), costs.size());
+  for (std::size_t i = 1; i < order.size(); ++i)
+    EXPECT_GE(costs[order[i - 1]], costs[order[i]]);
+
+  // several do every brick once between them
+  std::vector<std::atomic<int>> seen(costs.size());
+  ScheduleReport report;
+  for_each_brick_longest_first(
+      costs, 4, CancelToken{}, [&](brick_id_t b) { ++seen[b]; }, &report);
+  for (auto& n : seen) EXPECT_EQ(n.load(), 1);
+  EXPECT_EQ(report.workers, 4u);
+  EXPECT_GE(report.tail_idle_seconds, 0.0);
+}
+
+TEST_F(RenderTest, longest_first_schedule) {
+  StarField in_order = field;
+  in_order.render_with_callback(nullptr);
+
+  RenderOptions opts;
+  opts.brick_size = 4;
+  opts.threads = 3;
+  opts.schedule = BrickSchedule::longest_first;
+  auto job = field.render_async(nullptr, opts);
+  ASSERT_EQ(job.wait(), RenderStatus::completed);
+  EXPECT_EQ(field.grid, in_order.grid);
+
+  auto report = job.schedule_report();
+  EXPECT_EQ(report.workers, 3u);
+  EXPECT_GT(report.estimate_seconds, 0.0);
+  EXPECT_GT(report.utilisation(), 0.0);
+  EXPECT_LE(report.utilisation(), 1.0);
+
+  // the estimates follow the iterations the bricks actually took
+  BrickLayout layout(field.cube_size, field.dimension, 4);
+  auto costs = field.estimate_brick_costs(layout, 1);
+  ASSERT_EQ(costs.size(), layout.size());
+  double n = costs.size(), sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+  for (std::size_t b = 0; b < layout.size(); ++b) {
+    double iterations = 0;
+    for_each_cell(layout[b], [&](const idx_vector_t& ijk) {
+      iterations += in_order.grid[in_order.offset(ijk)];
+    });
+    sx += costs[b];
+    sy += iterations;
+    sxx += costs[b] * costs[b];
+    syy += iterations * iterations;
+    sxy += costs[b] * iterations;
+  }
+  double correlation = (n * sxy - sx * sy) /
+                       std::sqrt((n * sxx - sx * sx) * (n * syy - sy * sy));
+  EXPECT_GT(correlation, 0.5);
+}
+
+TEST_F(RenderTest, anytime_continues_to_the_full_field) {
+  StarField reference = field;
+  reference.render_with_callback(nullptr);
+
+  // out of time straight away: whatever got done is right
+  AnytimeOptions anytime;
+  anytime.budget = std::chrono::milliseconds(0);
+  anytime.coarsest_stride = 4;
+  Bounds roi{Coordinate{-1, -1, -0.5}, Coordinate{1, 1, 0.5}};
+  anytime.region_of_interest = roi;
+  auto first = field.render_anytime(anytime);
+  EXPECT_LE(first.cells_done, first.cells_total);
+  for (std::size_t cell = 0; cell < field.grid.size(); ++cell) {
+    if (field.grid[cell] == untouched) continue;
+    ASSERT_EQ(field.grid[cell], reference.grid[cell]);
+  }
+
+  // given the time, it carries on to the end
+  anytime.budget = std::chrono::minutes(1);
+  auto rest = field.render_anytime(anytime);
+  EXPECT_EQ(rest.status, RenderStatus::completed);
+  EXPECT_TRUE(rest.complete());
+  EXPECT_EQ(rest.cells_done, rest.cells_total);
+  EXPECT_EQ(field.grid, reference.grid);
+  idx_vector_t ijk{5, 7, 2};
+  EXPECT_EQ(field.at_best(ijk, 4), reference.grid[reference.offset(ijk)]);
+
+  // with nothing left to do, nothing changes
+  auto again = field.render_anytime(anytime);
+  EXPECT_TRUE(again.complete());
+  EXPECT_EQ(field.grid, reference.grid);
+}
+
+TEST_F(RenderTest, brick_cache_reuses_bricks) {
+  namespace fs = std::filesystem;
+  auto dir = fs::temp_directory_path() /
+             ("mgs_brick_cache_" + std::to_string(std::random_device{}()));
+  auto cache = std::make_shared<BrickCache>(dir);
+  RenderOptions opts;
+  opts.brick_size = 4;
+  opts.threads = 2;
+  opts.cache = cache;
+
+  StarField reference = field;
+  reference.render_with_callback(nullptr);
+
+  field.render_with_callback(nullptr, opts);
+  EXPECT_EQ(field.grid, reference.grid);
+  EXPECT_EQ(cache->stats().stores, 27u);
+  EXPECT_EQ(cache->stats().hits, 0u);
+
+  // again, straight from the cache, and so from a fresh one
+  std::atomic<int> calls{0};
+  field.grid.assign(field.grid.size(), untouched);
+  field.render_with_callback([&](Index, Position) { ++calls; }, opts);
+  EXPECT_EQ(field.grid, reference.grid);
+  EXPECT_EQ(calls, static_cast<int>(field.grid.size()));
+  EXPECT_EQ(cache->stats().hits, 27u);
+  cache = std::make_shared<BrickCache>(dir);
+  EXPECT_EQ(cache->entries(), 27u);
+  opts.cache = cache;
+
+  // a zoom on the same lattice, lined up with its bricks
+  const double spacing = 8.0 / 11;
+  Bounds zoom_box{Coordinate{-4 + 4 * spacing, -4 + 4 * spacing,
+                             -4 + 4 * spacing},
+                  Coordinate{4, 4, 4}};
+  StarField zoom(zoom_box, 8, 3, 64, 1.0, 6.0, 0.05);
+  zoom.stars = field.stars;
+  zoom.render_with_callback(nullptr, opts);
+  EXPECT_EQ(cache->stats().hits, 8u);
+  EXPECT_EQ(cache->stats().stores, 0u);
+  for (indexer_t k = 0; k < 8; ++k)
+    for (indexer_t j = 0; j < 8; ++j)
+      for (indexer_t i = 0; i < 8; ++i)
+        ASSERT_EQ(zoom[Index({i, j, k})],
+                  reference[Index({i + 4, j + 4, k + 4})]);
+
+  // other parameters, other keys
+  field.parms.iter_limit = 32;
+  field.render_with_callback(nullptr, opts);
+  EXPECT_EQ(cache->stats().hits, 8u);
+
+  // spacings closer than a float tells apart still key apart
+  const BrickLayout layout(field.cube_size, field.dimension, 4);
+  StarField nudged = field;
+  EXPECT_EQ(nudged.brick_key(layout[0]), field.brick_key(layout[0]));
+  nudged.box.pm[0] += 1e-9;
+  EXPECT_NE(nudged.brick_key(layout[0]), field.brick_key(layout[0]));
+
+  // bounded, the least recently used go
+  auto small = std::make_shared<BrickCache>(dir, 400);
+  EXPECT_LE(small->bytes(), 400u);
+  EXPECT_GT(small->stats().evictions, 0u);
+  small->clear();
+  EXPECT_EQ(small->entries(), 0u);
+  fs::remove_all(dir);
+}
+
+TEST(Pyramid, renders_only_the_bricks_viewed) {
+  // a spacing of 1 at level 0, so that the levels' cells coincide
+  // exactly where they nest
+  Bounds box{Coordinate{-4, -4, 0}, Coordinate{4, 4, 0}};
+  StarField prototype(box, 9, 2, 64, 1.0, 6.0, 0.05);
+  prototype.stars.push_back(Star{1.0, {-1, 0, 0}});
+  prototype.stars.push_back(Star{1.0, {1, 0, 0}});
+  PyramidOptions options;
+  options.brick_size = 4;
+  options.threads = 2;
+  options.resident_levels = 1;
+  options.capacity_bytes = 6 * 16 * sizeof(iterant_t);
+  FieldPyramid pyramid(prototype, options);
+  EXPECT_EQ(pyramid.cells_across(0), 9);
+  EXPECT_EQ(pyramid.bricks_across(2), 9);
+
+  Bounds all = box;
+  EXPECT_EQ(pyramid.level_for(all, 9), 0);
+  EXPECT_EQ(pyramid.request(0, all), 9u);
+  EXPECT_EQ(pyramid.request(0, all), 0u);  // all there already
+
+  StarField reference = prototype;
+  reference.render_with_callback(nullptr);
+  for (indexer_t j = 0; j < 9; ++j)
+    for (indexer_t i = 0; i < 9; ++i)
+      ASSERT_EQ(pyramid.at(0, {i, j, 0}),
+                reference.grid[reference.offset({i, j})]);
+
+  // a zoom renders the bricks it sees, and those nest
+  Bounds view{Coordinate{0.1, 0.1, 0}, Coordinate{0.8, 0.8, 0}};
+  EXPECT_EQ(pyramid.level_for(view, 6), 3);
+  EXPECT_EQ(pyramid.bricks_in(3, view).size(), 4u);
+  EXPECT_EQ(pyramid.request(3, view), 4u);
+  EXPECT_EQ(pyramid.stats().bricks, 13u);
+  EXPECT_EQ(pyramid.at(3, {32, 32, 0}), pyramid.at(0, {4, 4, 0}));
+  EXPECT_FALSE(pyramid.at(2, {18, 18, 0}));
+  EXPECT_EQ(pyramid.at_best(Coordinate{0.5, 0.5, 0}, 3),
+            *pyramid.at(3, {36, 36, 0}));
+  EXPECT_EQ(pyramid.at_best(Coordinate{-3, -3, 0}, 3),
+            *pyramid.at(0, {1, 1, 0}));
+
+  // panning away evicts the finer bricks, never level 0
+  Bounds pan{Coordinate{-2.9, -2.9, 0}, Coordinate{-2.2, -2.2, 0}};
+  EXPECT_EQ(pyramid.request(3, pan), 4u);
+  EXPECT_EQ(pyramid.stats().evictions, 2u);
+  EXPECT_EQ(pyramid.stats().bricks, 15u);
+  EXPECT_TRUE(pyramid.at(0, {4, 4, 0}));
+  EXPECT_TRUE(pyramid.find(PyramidBrick{3, {3, 3, 0}}));
+
+  // overlapping requests at once keep each brick, and its bytes, once
+  FieldPyramid shared(prototype, options);
+  std::thread other([&] { shared.request(0, all); });
+  shared.request(0, all);
+  other.join();
+  FieldPyramid alone(prototype, options);
+  alone.request(0, all);
+  EXPECT_EQ(shared.stats().bricks, 9u);
+  EXPECT_EQ(shared.stats().bytes, alone.stats().bytes);
+}
+
+TEST(Distributed, run_length_encoding) {
+  std::vector<iterant_t> counts{5, 5, 5, 5, 9, -1, -1, 64, 64, 64, 64, 3};
+  auto runs = encode_runs(counts.data(), counts.size());
+  EXPECT_LT(runs.size(), counts.size() * sizeof(iterant_t));
+  std::vector<iterant_t> back(counts.size());
+  EXPECT_TRUE(decode_runs(runs.data(), runs.size(), back.data(), back.size()));
+  EXPECT_EQ(back, counts);
+  EXPECT_FALSE(decode_runs(runs.data(), runs.size(), back.data(), 5));
+}
+
+TEST_F(RenderTest, distributed_survives_a_worker_dying) {
+  auto path = std::filesystem::temp_directory_path() /
+              ("mgs_coordinator_" + std::to_string(::getpid()));
+  std::vector<pid_t> children;
+  {
+    Coordinator coordinator("unix:" + path.string());
+    ASSERT_TRUE(coordinator.listening());
+
+    // the first to join reads a little of its work, then dies
+    int joined[2];
+    ASSERT_EQ(::pipe(joined), 0);
+    pid_t dying = ::fork();
+    if (dying == 0) {
+      int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, path.c_str(),
+                   sizeof address.sun_path - 1);
+      char c = 0;
+      if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                    sizeof address) != 0 ||
+          ::write(joined[1], &c, 1) != 1 || ::read(fd, &c, 1) != 1)
+        ::_exit(1);
+      ::_exit(0);
+    }
+    char c;
+    ASSERT_EQ(::read(joined[0], &c, 1), 1);
+    ::close(joined[0]);
+    ::close(joined[1]);
+    children.push_back(dying);
+
+    for (int w = 0; w < 2; ++w) {
+      pid_t worker = ::fork();
+      if (worker == 0) ::_exit(run_worker(coordinator.endpoint()) ? 0 : 1);
+      children.push_back(worker);
+    }
+
+    DistributedOptions options;
+    options.brick_size = 4;
+    StarField reference = field;
+    reference.render_with_callback(nullptr);
+    EXPECT_EQ(coordinator.render(field, options), RenderStatus::completed);
+    EXPECT_EQ(field.grid, reference.grid);
+    const auto& report = coordinator.report();
+    EXPECT_EQ(report.workers, 3u);
+    EXPECT_EQ(report.lost, 1u);
+    EXPECT_GE(report.reissued, 1u);
+    EXPECT_EQ(report.bricks, 27u);
+    EXPECT_LT(report.received_bytes, report.cells_bytes);
+
+    // the workers stay on for the next render
+    field.parms.iter_limit = 32;
+    reference.parms.iter_limit = 32;
+    reference.render_with_callback(nullptr);
+    EXPECT_EQ(coordinator.render(field, options), RenderStatus::completed);
+    EXPECT_EQ(field.grid, reference.grid);
+    EXPECT_EQ(coordinator.workers(), 2u);
+  }
+
+  for (auto child : children) {
+    int status = -1;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+TEST_F(RenderTest, daemon_queues_by_priority_and_reuses_grids) {
+  auto dir = std::filesystem::temp_directory_path();
+  auto tag = std::to_string(::getpid());
+  auto output = dir / ("mgs_daemon_out_" + tag);
+  DaemonOptions options;
+  options.threads = 2;
+  options.brick_size = 4;
+  RenderDaemon daemon("unix:" + (dir / ("mgs_daemon_" + tag)).string(),
+                      options);
+  ASSERT_TRUE(daemon.listening());
+
+  StarField reference = field;
+  reference.render_with_callback(nullptr);
+
+  DaemonClient client(daemon.endpoint());
+  ASSERT_TRUE(client.connected());
+  StarField got = field;
+  DaemonReply reply;
+  ASSERT_TRUE(client.render(got, {}, &reply));
+  EXPECT_EQ(reply.status, RenderStatus::completed);
+  EXPECT_EQ(got.grid, reference.grid);
+
+  // to a file this time, into the grid the first job left
+  DaemonJob to_file;
+  to_file.output_path = output.string();
+  StarField from_file = field;
+  ASSERT_TRUE(client.render(from_file, to_file, &reply));
+  EXPECT_EQ(reply.status, RenderStatus::completed);
+  ASSERT_TRUE(read_result_file(output.string(), from_file));
+  EXPECT_EQ(from_file.grid, reference.grid);
+  std::filesystem::remove(output);
+  EXPECT_EQ(daemon.stats().grids_allocated, 1u);
+
+  // queued while paused, then run highest priority first
+  daemon.pause();
+  std::vector<std::unique_ptr<DaemonClient>> clients;
+  const std::int32_t priorities[] = {0, 5, 1};
+  for (auto priority : priorities) {
+    clients.push_back(std::make_unique<DaemonClient>(daemon.endpoint()));
+    DaemonJob job;
+    job.priority = priority;
+    ASSERT_TRUE(clients.back()->submit(field, job));
+  }
+  while (daemon.stats().queued < 3) std::this_thread::yield();
+  daemon.resume();
+  std::uint64_t sequences[3];
+  for (int c = 0; c < 3; ++c) {
+    StarField back = field;
+    ASSERT_TRUE(clients[c]->receive(back, &reply));
+    EXPECT_EQ(back.grid, reference.grid);
+    sequences[c] = reply.sequence;
+  }
+  EXPECT_EQ(sequences[1], 3u);
+  EXPECT_EQ(sequences[2], 4u);
+  EXPECT_EQ(sequences[0], 5u);
+  EXPECT_EQ(daemon.stats().jobs, 5u);
+}
+
+TEST_F(RenderTest, daemon_publishes_to_shared_memory) {
+  auto tag = std::to_string(::getpid());
+  DaemonOptions options;
+  options.threads = 2;
+  options.brick_size = 4;
+  RenderDaemon daemon("unix:" + (std::filesystem::temp_directory_path() /
+                                 ("mgs_daemon_shared_" + tag))
+                                    .string(),
+                      options);
+  ASSERT_TRUE(daemon.listening());
+
+  StarField reference = field;
+  reference.render_with_callback(nullptr);
+
+  // left for the client to map, and remove
+  DaemonJob to_shared;
+  to_shared.shared_name = "/mgs_daemon_" + tag;
+  StarField unsent = field;
+  DaemonReply reply;
+  {
+    DaemonClient client(daemon.endpoint());
+    ASSERT_TRUE(client.render(unsent, to_shared, &reply));
+  }
+  EXPECT_EQ(reply.status, RenderStatus::completed);
+  {
+    SharedFieldView view(to_shared.shared_name);
+    ASSERT_TRUE(view.valid());
+    EXPECT_TRUE(view.complete());
+    std::vector<iterant_t> grid;
+    ASSERT_TRUE(view.read(grid));
+    EXPECT_EQ(grid, reference.grid);
+  }
+  EXPECT_TRUE(remove_shared_field(to_shared.shared_name));
+
+  // removed by the daemon when the client goes part way through
+  StarField slow = field;
+  slow.parms.iter_limit = 30000;
+  slow.parms.escape_radius = 1e6;
+  {
+    DaemonClient client(daemon.endpoint());
+    ASSERT_TRUE(client.submit(slow, to_shared));
+    while (!SharedFieldView(to_shared.shared_name).valid())
+      std::this_thread::yield();
+  }
+  while (daemon.stats().jobs < 2) std::this_thread::yield();
+  EXPECT_EQ(daemon.stats().cancelled, 1u);
+  EXPECT_FALSE(SharedFieldView(to_shared.shared_name).valid());
+  EXPECT_FALSE(remove_shared_field(to_shared.shared_name));
+}
+
+TEST_F(RenderTest, shared_field_publishes_bricks_live) {
+  const std::string name = "/mgs_field_" + std::to_string(::getpid());
+  SharedFieldWriter writer(name, field);
+  ASSERT_TRUE(writer.valid());
+  SharedFieldView view(name);
+  ASSERT_TRUE(view.valid());
+  EXPECT_EQ(view.cube_size(), field.cube_size);
+  ASSERT_EQ(view.cells(), field.grid.size());
+  EXPECT_EQ(std::count(view.grid(), view.grid() + view.cells(),
+                       iterant_t(untouched)),
+            std::ptrdiff_t(view.cells()));
+
+  // each brick is in the view as soon as it is published
+  RenderOptions options;
+  options.threads = 2;
+  options.brick_size = 4;
+  auto publish = writer.publisher();
+  std::atomic<int> seen{0};
+  field.render_with_brick_callback(
+      [&](const Brick& brick, Span<const iterant_t> counts) {
+        publish(brick, counts);
+        std::vector<iterant_t> back;
+        if (view.read(brick, back) &&
+            std::equal(back.begin(), back.end(), counts.data()))
+          ++seen;
+      },
+      options);
+  writer.finish();
+  EXPECT_EQ(seen, 27);
+  EXPECT_EQ(view.bricks(), 27u);
+  EXPECT_EQ(view.generation(), 54u);
+  EXPECT_TRUE(view.complete());
+  std::vector<iterant_t> grid;
+  ASSERT_TRUE(view.read(grid));
+  EXPECT_EQ(grid, field.grid);
+}
+
+TEST_F(RenderTest, sweep_matches_a_render_per_parameter_set) {
+  std::vector<SweepPoint> points;
+  for (int i = 0; i < 10; ++i)
+    points.push_back({0.8 + 0.05 * i, 0.04 + 0.002 * (i % 3),
+                      {1.0, 1.0 + 0.1 * i}});
+  RenderOptions options;
+  options.threads = 2;
+  options.brick_size = 4;
+
+  for (auto integrator : {IntegratorKind::euler, IntegratorKind::yoshida4}) {
+    field.parms.integrator = integrator;
+    ASSERT_TRUE(sweeps_in_lanes(field));
+    std::vector<StarField> fields;
+    ASSERT_EQ(render_sweep(field, points, fields, options),
+              RenderStatus::completed);
+    ASSERT_EQ(fields.size(), points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      StarField one = field;
+      one.parms.gravitational_constant = points[i].gravitational_constant;
+      one.parms.delta_t = points[i].delta_t;
+      one.stars[1].mass = points[i].star_masses[1];
+      one.render_with_callback(nullptr);
+      EXPECT_EQ(fields[i].grid, one.grid) << i;
+      EXPECT_EQ(fields[i].stars[1].mass, one.stars[1].mass);
+    }
+  }
+
+  // a render per point, on the same options throughout
+  field.parms.kepler_tolerance = 1e-3;
+  ASSERT_FALSE(sweeps_in_lanes(field));
+  points.resize(3);
+  std::vector<StarField> fields;
+  ASSERT_EQ(render_sweep(field, points, fields, options),
+            RenderStatus::completed);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    StarField one = fields[i];
+    one.render_with_callback(nullptr);
+    EXPECT_EQ(fields[i].grid, one.grid) << i;
+  }
+  // a mass short for one of the stars refuses the whole sweep
+  points[1].star_masses.pop_back();
+  EXPECT_EQ(render_sweep(field, points, fields, options),
+            RenderStatus::cancelled);
+  EXPECT_TRUE(fields.empty());
+}
+
+TEST_F(RenderTest, animation_pipelines_frames_and_resumes) {
+  namespace fs = std::filesystem;
+  const auto dir = (fs::temp_directory_path() /
+                    ("mgs_animation_" + std::to_string(std::random_device{}())))
+                       .string();
+  auto start = keyframe_of(field, 0);
+  auto end = keyframe_of(field, 4);
+  end.stars[0].position = Position{-1.5, 0.5, 0};
+  end.stars[1].mass = 2.0;
+  end.gravitational_constant = 1.2;
+  const std::vector<AnimationKeyframe> keys{end, start};
+
+  auto middle = interpolate_keyframes(keys, 2);
+  EXPECT_DOUBLE_EQ(middle.stars[0].position[0], -1.25);
+  EXPECT_DOUBLE_EQ(middle.stars[1].mass, 1.5);
+  EXPECT_DOUBLE_EQ(middle.gravitational_constant, 1.1);
+  EXPECT_EQ(interpolate_keyframes(keys, 9).stars[1].mass, 2.0);
+
+  AnimationOptions options;
+  options.render.threads = 2;
+  options.render.brick_size = 5;
+  options.directory = dir;
+  std::mutex lock;
+  std::vector<std::size_t> handed;
+  auto on_frame = [&](std::size_t frame, const StarField&) {
+    std::lock_guard<std::mutex> guard(lock);
+    handed.push_back(frame);
+  };
+
+  auto report = render_animation(field, keys, 6, options, on_frame);
+  EXPECT_EQ(report.status, RenderStatus::completed);
+  EXPECT_EQ(report.rendered, 6u);
+  EXPECT_EQ(report.exported, 6u);
+  EXPECT_EQ(report.grids_allocated, 2u);
+  EXPECT_EQ(handed, (std::vector<std::size_t>{0, 1, 2, 3, 4, 5}));
+  for (std::size_t frame = 0; frame < 6; ++frame) {
+    StarField one = field;
+    auto key = interpolate_keyframes(keys, frame);
+    one.stars = key.stars;
+    one.parms.gravitational_constant = key.gravitational_constant;
+    one.render_with_callback(nullptr);
+    StarField back = field;
+    ASSERT_TRUE(read_animation_frame(dir, frame, back));
+    EXPECT_EQ(back.grid, one.grid) << frame;
+  }
+
+  // a frame lost, and one whose keyframe has moved
+  fs::remove(animation_frame_path(dir, 2));
+  auto later = keys;
+  later[0].frame = 5;
+  handed.clear();
+  report = render_animation(field, later, 6, options, on_frame);
+  EXPECT_EQ(report.rendered, 4u);  // 2 lost; 1, 3 and 4 moved, 5 not
+  EXPECT_EQ(report.resumed, 2u);
+  EXPECT_EQ(handed, (std::vector<std::size_t>{1, 2, 3, 4}));
+
+  report = render_animation(field, later, 6, options, on_frame);
+  EXPECT_EQ(report.rendered, 0u);
+  EXPECT_EQ(report.resumed, 6u);
+  EXPECT_EQ(report.grids_allocated, 1u);
+  fs::remove_all(dir);
+}
+
 TEST(Index, operator_plus) {
   Index idx{0, 1, 2};
   index_bits_t bits{0b101};